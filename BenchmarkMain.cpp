@@ -0,0 +1,42 @@
+﻿#include <Siv3D.hpp> // Siv3D v0.6.13
+
+#ifdef SIV3D_YOGA_BENCHMARK
+
+#include "LayoutBenchmark.hpp"
+
+// ウィンドウを作らずに実行する
+SIV3D_SET(EngineOption::Renderer::Headless);
+
+// 使い方: Siv3DYogaTest(benchmark).exe [--out result.json] [--baseline previous.json] [--threshold 0.1] [--iterations 20] [--max-nodes 100000] [--threads 1,2,4,8]
+void Main()
+{
+	Console.open();
+
+	const auto options = LayoutBenchmark::Options::FromCommandLine(System::GetCommandLineArgs());
+
+	LayoutBenchmark benchmark{ options };
+
+	const auto results = benchmark.run();
+	const auto regressions = benchmark.compareWithBaseline(results);
+
+	auto passes = benchmark.passes();
+
+	for (auto& pass : passes)
+	{
+		pass.run();
+	}
+
+	if (not benchmark.save(results, passes, regressions))
+	{
+		Console << U"failed to write: {}"_fmt(options.outputPath);
+	}
+
+	for (auto& regression : regressions)
+	{
+		Console << U"REGRESSION {} {}: {:.1f}us -> {:.1f}us"_fmt(regression.key, regression.pass, regression.baseline, regression.current);
+	}
+
+	Console << U"{} results written to {} ({} regressions)"_fmt(results.size(), options.outputPath, regressions.size());
+}
+
+#endif
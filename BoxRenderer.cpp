@@ -0,0 +1,97 @@
+﻿#include "BoxRenderer.hpp"
+
+namespace
+{
+	bool HasArea(const RectF& rect)
+	{
+		return (0 < rect.w) && (0 < rect.h);
+	}
+}
+
+void BoxRenderer::DrawFrame(const RectF& rect, const Thickness& widths, const ColorF& color)
+{
+	if (color.a == 0)
+	{
+		return;
+	}
+
+	for (const auto& edge : FrameEdges(rect, widths))
+	{
+		if (HasArea(edge))
+		{
+			edge.draw(color);
+		}
+	}
+}
+
+std::array<RectF, 4> BoxRenderer::FrameEdges(const RectF& rect, const Thickness& widths)
+{
+	const double width = Max(rect.w, 0.0);
+	const double height = Max(rect.h, 0.0);
+
+	const double top = Clamp(widths.top, 0.0, height);
+	const double bottom = Clamp(widths.bottom, 0.0, height - top);
+	const double left = Clamp(widths.left, 0.0, width);
+	const double right = Clamp(widths.right, 0.0, width - left);
+
+	// 上下の辺は角を含む幅いっぱいに、左右の辺はその間に置いて重ならないようにする
+	const double middle = height - top - bottom;
+
+	return{
+		RectF{ rect.x, rect.y, width, top },
+		RectF{ rect.x, (rect.y + height - bottom), width, bottom },
+		RectF{ rect.x, (rect.y + top), left, middle },
+		RectF{ (rect.x + width - right), (rect.y + top), right, middle },
+	};
+}
+
+void BoxRenderer::addFrame(const RectF& rect, const Thickness& widths, const ColorF& color)
+{
+	if (color.a == 0)
+	{
+		return;
+	}
+
+	for (const auto& edge : FrameEdges(rect, widths))
+	{
+		addRect(edge, color);
+	}
+}
+
+void BoxRenderer::addRect(const RectF& rect, const ColorF& color)
+{
+	if (not HasArea(rect) || color.a == 0)
+	{
+		return;
+	}
+
+	assert((m_buffer.vertices.size() + 4) <= (size_t{ Largest<Vertex2D::IndexType> } + 1));
+
+	const auto base = static_cast<Vertex2D::IndexType>(m_buffer.vertices.size());
+	const Float4 color4 = color.toFloat4();
+
+	const Float2 tl{ static_cast<float>(rect.x), static_cast<float>(rect.y) };
+	const Float2 br{ static_cast<float>(rect.x + rect.w), static_cast<float>(rect.y + rect.h) };
+
+	m_buffer.vertices.push_back({ .pos = tl, .tex = { 0, 0 }, .color = color4 });
+	m_buffer.vertices.push_back({ .pos = { br.x, tl.y }, .tex = { 1, 0 }, .color = color4 });
+	m_buffer.vertices.push_back({ .pos = { tl.x, br.y }, .tex = { 0, 1 }, .color = color4 });
+	m_buffer.vertices.push_back({ .pos = br, .tex = { 1, 1 }, .color = color4 });
+
+	m_buffer.indices.push_back({ base, static_cast<Vertex2D::IndexType>(base + 1), static_cast<Vertex2D::IndexType>(base + 2) });
+	m_buffer.indices.push_back({ static_cast<Vertex2D::IndexType>(base + 2), static_cast<Vertex2D::IndexType>(base + 1), static_cast<Vertex2D::IndexType>(base + 3) });
+}
+
+void BoxRenderer::clear()
+{
+	m_buffer.vertices.clear();
+	m_buffer.indices.clear();
+}
+
+void BoxRenderer::draw() const
+{
+	if (not isEmpty())
+	{
+		m_buffer.draw();
+	}
+}
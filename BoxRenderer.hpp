@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "LayoutResults.hpp"
+
+// ボックスモデルの枠 (margin、border、padding) を、辺ごとの重ならない四角形で描く
+// 多角形の演算をせず、1つの枠は多くても4つの四角形になる
+// 追加した四角形は頂点バッファに溜まり、clearするまで何度でも描ける (頂点の番号は16bitなので16384個まで)
+class BoxRenderer
+{
+public:
+
+	// rectの内側にwidthsの幅で枠を描く
+	static void DrawFrame(const RectF& rect, const Thickness& widths, const ColorF& color);
+
+	// 枠の4辺の四角形。幅のない辺は空の矩形になる
+	// 幅は0以上に、向かい合う辺の和はrectの大きさ以下に切り詰める
+	static std::array<RectF, 4> FrameEdges(const RectF& rect, const Thickness& widths);
+
+public:
+
+	void addFrame(const RectF& rect, const Thickness& widths, const ColorF& color);
+
+	void addRect(const RectF& rect, const ColorF& color);
+
+	void clear();
+
+	bool isEmpty() const noexcept { return m_buffer.vertices.isEmpty(); }
+
+	size_t quadCount() const noexcept { return m_buffer.vertices.size() / 4; }
+
+	void draw() const;
+
+private:
+
+	Buffer2D m_buffer;
+};
@@ -0,0 +1,83 @@
+﻿#include "BoxRenderer.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+
+namespace
+{
+	constexpr size_t NodeCount = 1'000;
+
+	struct Frame
+	{
+		RectF outer;
+
+		RectF inner;
+
+		Thickness widths;
+	};
+
+	// 辺の四角形の面積の和を、多角形の差の面積と比べる
+	bool MatchesSubtract(const Frame& frame)
+	{
+		double subtractArea = 0;
+		for (const auto& polygon : Geometry2D::Subtract(frame.outer.asPolygon(), frame.inner))
+		{
+			subtractArea += polygon.area();
+		}
+
+		double edgeArea = 0;
+		for (const auto& edge : BoxRenderer::FrameEdges(frame.outer, frame.widths))
+		{
+			if (0 < edge.w && 0 < edge.h)
+			{
+				edgeArea += edge.area();
+			}
+		}
+
+		return (AbsDiff(subtractArea, edgeArea) <= 0.01);
+	}
+
+	const UnitTest::Registration BoxRendererTest{ U"BoxRenderer::FrameEdges", [](Array<String>& failures)
+		{
+			const auto root = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Cards, NodeCount);
+			LayoutTree tree{ root };
+			tree.calculateLayout(1280.0f, 720.0f);
+
+			// WidgetTreeEditorと同じく、margin、border、paddingの3つの枠
+			Array<Frame> frames;
+			const auto& store = tree.layoutResultsStore();
+
+			for (uint32 index = 0; index < store.capacity(); index++)
+			{
+				if (not store.hasResults(index))
+				{
+					continue;
+				}
+
+				const auto layout = store.get(index);
+				frames.push_back({ layout.outerRect(), layout.rect(), layout.margin });
+				frames.push_back({ layout.rect(), layout.rectWithoutBorder(), layout.border });
+				frames.push_back({ layout.rectWithoutBorder(), layout.innerRect(), layout.padding });
+			}
+
+			// 辺ごとに幅が違う枠と、片側だけの枠
+			const RectF outer{ 10.5, 20.25, 200, 120 };
+			frames.push_back({ outer, RectF{ 13.5, 21.25, 190, 112 }, Thickness{ .left = 3, .top = 1, .right = 7, .bottom = 7 } });
+			frames.push_back({ outer, RectF{ 10.5, 30.25, 200, 110 }, Thickness{ .top = 10 } });
+
+			size_t mismatches = 0;
+			for (const auto& frame : frames)
+			{
+				mismatches += not MatchesSubtract(frame);
+			}
+
+			if (mismatches)
+			{
+				failures << U"{} of {} box frames differ in area from the polygon subtraction"_fmt(mismatches, frames.size());
+			}
+		} };
+}
+
+#endif
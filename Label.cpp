@@ -31,20 +31,17 @@ static void CalculatePos(Vec2& penPos, Vec2& renderSize, const Glyph& glyph, con
 Label::Label()
 {
 	borderColor = Color::Zero();
-	m_glyphCache = { };
 }
 
 void Label::setText(const StringView text)
 {
 	m_text = text;
-	m_glyphCache = m_font.getGlyphs(m_text);
 	markLayoutDirty();
 }
 
 void Label::setFont(Font font)
 {
 	m_font = font;
-	m_glyphCache = m_font.getGlyphs(m_text);
 	markLayoutDirty();
 }
 
@@ -56,13 +53,33 @@ void Label::drawContent(const LayoutResults& layout) const
 void Label::onLayoutNodeAttach(facebook::yoga::Node& node)
 {
 	node.setMeasureFunc([](YGNodeConstRef node, float width, YGMeasureMode widthMode, float height, YGMeasureMode heightMode) -> YGSize
-		{ return static_cast<Label*>(Widget::GetInstance(node))->measureCallback(node, width, widthMode, height, heightMode); }
+		{
+			// Labelが破棄されたノードは次のconstructで解放されるので、大きさを持たせない
+			auto label = static_cast<Label*>(Widget::GetInstance(node));
+			if (not label)
+			{
+				return YGSize{ 0, 0 };
+			}
+
+			label->recordMeasure();
+			return label->measureCallback(node, width, widthMode, height, heightMode);
+		}
 	);
 	node.setBaselineFunc([](YGNodeConstRef node, float width, float height) -> float
-		{ return static_cast<Label*>(Widget::GetInstance(node))->baselineCallback(node, width, height); }
+		{
+			auto label = static_cast<Label*>(Widget::GetInstance(node));
+			return label ? label->baselineCallback(node, width, height) : height;
+		}
 	);
 }
 
+void Label::onLayoutSnapshot()
+{
+	m_layoutFont = m_font;
+	m_layoutGlyphs = m_font.getGlyphs(m_text);
+	m_layoutTextEmpty = m_text.empty();
+}
+
 YGSize Label::measureCallback(
 	YGNodeConstRef,
 	float width,
@@ -79,9 +96,9 @@ YGSize Label::measureCallback(
 
 	Vec2 penPos{ 0, 0 };
 	Vec2 renderSize{ 0, 0 };
-	for (auto& glyph : m_glyphCache)
+	for (auto& glyph : m_layoutGlyphs)
 	{
-		CalculatePos(penPos, renderSize, glyph, m_font, maxWidth);
+		CalculatePos(penPos, renderSize, glyph, m_layoutFont, maxWidth);
 	}
 
 	float measuredWidth = 0, measuredHeight = 0;
@@ -105,5 +122,5 @@ YGSize Label::measureCallback(
 
 float Label::baselineCallback(YGNodeConstRef, float width, float height)
 {
-	return m_text.empty() ? 0.0f : m_font.ascender();
+	return m_layoutTextEmpty ? 0.0f : m_layoutFont.ascender();
 }
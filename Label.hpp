@@ -12,6 +12,8 @@ public:
 
 public:
 
+	StringView typeName() const override { return U"Label"; }
+
 	const String& text() const { return m_text; }
 
 	void setText(const StringView text);
@@ -26,18 +28,29 @@ public:
 
 private:
 
+	// 破棄時に文字列のバッファを引き取る
+	friend class WidgetPool;
+
 	String m_text = U"";
 
 	Font m_font = SimpleGUI::GetFont();
 
 	ColorF m_color = Palette::White;
 
-	Array<Glyph> m_glyphCache;
+	// 計測関数が読む、onLayoutSnapshotの時点のフォントと文字
+	// グリフの取得はここで行うので、バッチ中に何度書き換えても一度で済む
+	Font m_layoutFont = m_font;
+
+	Array<Glyph> m_layoutGlyphs;
+
+	bool m_layoutTextEmpty = true;
 
 	void drawContent(const LayoutResults& layout) const override;
 
 	void onLayoutNodeAttach(facebook::yoga::Node& node) override;
 
+	void onLayoutSnapshot() override;
+
 	YGSize measureCallback(YGNodeConstRef, float, YGMeasureMode, float, YGMeasureMode);
 
 	float baselineCallback(YGNodeConstRef, float, float);
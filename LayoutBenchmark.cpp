@@ -0,0 +1,1532 @@
+﻿#include "LayoutBenchmark.hpp"
+#include "Label.hpp"
+#include "WidgetSnapshot.hpp"
+#include "WidgetTreeLoader.hpp"
+#include "Selector.hpp"
+#include "BoxRenderer.hpp"
+
+using namespace facebook;
+
+namespace
+{
+	// yogaもLayoutTreeも再帰で辿るため、深い鎖はこの深さで折り返す
+	constexpr size_t MaxChainDepth = 256;
+
+	constexpr size_t BalancedBranching = 4;
+
+	constexpr size_t TextGridColumns = 16;
+
+	constexpr size_t CardLabels = 8;
+
+	Array<Widget*> CollectContainers(Widget& root)
+	{
+		Array<Widget*> result;
+		Array<Widget*> stack{ &root };
+
+		while (not stack.empty())
+		{
+			Widget* widget = stack.back();
+			stack.pop_back();
+
+			if (widget->allowChildren())
+			{
+				result.push_back(widget);
+			}
+
+			for (auto& child : widget->children())
+			{
+				stack.push_back(child.get());
+			}
+		}
+
+		return result;
+	}
+
+	Array<Label*> CollectLabels(Widget& root)
+	{
+		Array<Label*> result;
+		Array<Widget*> stack{ &root };
+
+		while (not stack.empty())
+		{
+			Widget* widget = stack.back();
+			stack.pop_back();
+
+			if (auto label = dynamic_cast<Label*>(widget))
+			{
+				result.push_back(label);
+			}
+
+			for (auto& child : widget->children())
+			{
+				stack.push_back(child.get());
+			}
+		}
+
+		return result;
+	}
+
+	std::shared_ptr<Widget> CreateBox(float width, float height, WidgetPool* pool = nullptr)
+	{
+		auto widget = WidgetPool::Create<Widget>(pool);
+		widget->style().setDimension(yoga::Dimension::Width, yoga::Style::Length::points(width));
+		widget->style().setDimension(yoga::Dimension::Height, yoga::Style::Length::points(height));
+		widget->style().setBorder(yoga::Edge::All, yoga::Style::Length::points(1));
+		return widget;
+	}
+
+	std::shared_ptr<Label> CreateLabel(size_t index, WidgetPool* pool)
+	{
+		auto label = WidgetPool::Create<Label>(pool);
+		label->setColor(Palette::Black);
+		label->setText(U"Item {}"_fmt(index));
+		label->style().setPadding(yoga::Edge::All, yoga::Style::Length::points(2));
+		return label;
+	}
+
+	// [0] 深い鎖: 親子1本の列をMaxChainDepthごとに根へぶら下げる
+	void BuildDeepChain(Widget& root, size_t nodeCount, WidgetPool* pool)
+	{
+		size_t remaining = nodeCount - 1;
+
+		while (remaining > 0)
+		{
+			Widget* parent = &root;
+			size_t depth = Min(remaining, MaxChainDepth);
+
+			for (size_t i = 0; i < depth; i++)
+			{
+				auto child = WidgetPool::Create<Widget>(pool);
+				child->style().setPadding(yoga::Edge::All, yoga::Style::Length::points(1));
+				child->style().setBorder(yoga::Edge::All, yoga::Style::Length::points(1));
+
+				Widget* next = child.get();
+				parent->appendChild(std::move(child));
+				parent = next;
+			}
+
+			remaining -= depth;
+		}
+	}
+
+	// [1] 平坦な一覧: 根の直下に固定高さの行を並べる
+	void BuildWideList(Widget& root, size_t nodeCount, WidgetPool* pool)
+	{
+		root.style().setFlexDirection(yoga::FlexDirection::Column);
+
+		for (size_t i = 1; i < nodeCount; i++)
+		{
+			auto row = WidgetPool::Create<Widget>(pool);
+			row->style().setDimension(yoga::Dimension::Height, yoga::Style::Length::points(20));
+			row->style().setMargin(yoga::Edge::Bottom, yoga::Style::Length::points(1));
+			root.appendChild(std::move(row));
+		}
+	}
+
+	// [2] 平衡木: 幅優先でBalancedBranching分岐させる
+	void BuildBalanced(Widget& root, size_t nodeCount, WidgetPool* pool)
+	{
+		Array<Widget*> queue{ &root };
+		size_t created = 1;
+
+		for (size_t head = 0; created < nodeCount; head++)
+		{
+			Widget* parent = queue[head];
+			parent->style().setFlexDirection(head % 2 == 0 ? yoga::FlexDirection::Row : yoga::FlexDirection::Column);
+
+			for (size_t i = 0; i < BalancedBranching && created < nodeCount; i++, created++)
+			{
+				auto child = WidgetPool::Create<Widget>(pool);
+				child->style().setFlexGrow(yoga::FloatOptional{ 1 });
+				child->style().setPadding(yoga::Edge::All, yoga::Style::Length::points(1));
+
+				queue.push_back(child.get());
+				parent->appendChild(std::move(child));
+			}
+		}
+	}
+
+	// [3] テキストの格子: 折り返す行の中にLabelを並べる
+	void BuildTextGrid(Widget& root, size_t nodeCount, WidgetPool* pool)
+	{
+		root.style().setFlexDirection(yoga::FlexDirection::Column);
+
+		std::shared_ptr<Widget> row;
+		for (size_t i = 1; i < nodeCount; i++)
+		{
+			if (not row || row->children().size() >= TextGridColumns)
+			{
+				row = WidgetPool::Create<Widget>(pool);
+				row->style().setFlexDirection(yoga::FlexDirection::Row);
+				row->style().setFlexWrap(yoga::Wrap::Wrap);
+				root.appendChild(row);
+				continue;
+			}
+
+			row->appendChild(CreateLabel(i, pool));
+		}
+	}
+
+	// [4] カード: 固定サイズのカードを折り返して並べ、中にLabelを縦に並べる
+	void BuildCards(Widget& root, size_t nodeCount, WidgetPool* pool)
+	{
+		root.style().setFlexDirection(yoga::FlexDirection::Row);
+		root.style().setFlexWrap(yoga::Wrap::Wrap);
+
+		// カードは全て同じスタイルを共有する
+		const StyleClass::Pointer cardStyle = [&]
+			{
+				const auto box = CreateBox(160, 200, pool);
+				box->style().setFlexDirection(yoga::FlexDirection::Column);
+				box->style().setPadding(yoga::Edge::All, yoga::Style::Length::points(4));
+				box->style().setMargin(yoga::Edge::All, yoga::Style::Length::points(2));
+				return StyleClass::Intern(box->style());
+			}();
+
+		std::shared_ptr<Widget> card;
+		for (size_t i = 1; i < nodeCount; i++)
+		{
+			if (not card || card->children().size() >= CardLabels)
+			{
+				card = WidgetPool::Create<Widget>(pool);
+				card->setStyleClass(cardStyle);
+				root.appendChild(card);
+				continue;
+			}
+
+			card->appendChild(CreateLabel(i, pool));
+		}
+	}
+
+	// 以前のWidget::childrenと同じく、子をstd::listに持つ複製
+	struct ListNode
+	{
+		std::shared_ptr<Widget> widget;
+
+		std::list<std::shared_ptr<ListNode>> children;
+	};
+
+	std::shared_ptr<ListNode> CreateListTree(const std::shared_ptr<Widget>& widget)
+	{
+		auto node = std::make_shared<ListNode>();
+		node->widget = widget;
+
+		for (auto& child : widget->children())
+		{
+			node->children.push_back(CreateListTree(child));
+		}
+
+		return node;
+	}
+
+	// 以前のdrawChildrenのように子を値で受け、参照カウントを増減させながら辿る
+	size_t TraverseList(std::shared_ptr<ListNode> node)
+	{
+		size_t visited = (node->widget->borderColor.a != 0);
+
+		for (auto child : node->children)
+		{
+			visited += TraverseList(child) + 1;
+		}
+
+		return visited;
+	}
+
+	size_t TraverseContiguous(const std::shared_ptr<Widget>& widget)
+	{
+		size_t visited = (widget->borderColor.a != 0);
+
+		for (auto& child : widget->children())
+		{
+			visited += TraverseContiguous(child) + 1;
+		}
+
+		return visited;
+	}
+
+	Widget* FindById(Widget& widget, int64 id)
+	{
+		if (widget.id() == id)
+		{
+			return &widget;
+		}
+
+		for (auto& child : widget.children())
+		{
+			if (auto found = FindById(*child, id))
+			{
+				return found;
+			}
+		}
+
+		return nullptr;
+	}
+
+	// 以前のWidgetTreeEditorと同じく、子を後ろから再帰で辿って一番手前のWidgetを探す
+	Widget* HitTestRecursive(Widget& widget, Vec2 pos)
+	{
+		auto layout = widget.layoutResults();
+
+		if (not layout)
+		{
+			return nullptr;
+		}
+
+		for (auto it = widget.children().rbegin(); it != widget.children().rend(); ++it)
+		{
+			if (auto found = HitTestRecursive(**it, pos))
+			{
+				return found;
+			}
+		}
+
+		return layout->rect().intersects(pos) ? &widget : nullptr;
+	}
+
+	size_t CountAll(const Widget& widget)
+	{
+		size_t count = 1;
+
+		for (auto& child : widget.children())
+		{
+			count += CountAll(*child);
+		}
+
+		return count;
+	}
+
+	// Widget::drawと同じく、描かれうる範囲がclipと重ならない部分木は辿らない
+	void CountCulled(const Widget& widget, const LayoutResultsStore& store, const RectF& clip, size_t& visited, size_t& drawn)
+	{
+		const uint32 index = widget.layoutIndex();
+
+		if (not store.hasResults(index) || not store.bounds(index).intersects(clip))
+		{
+			return;
+		}
+
+		visited++;
+
+		const RectF rect = store.rect(index);
+		if (rect.intersects(clip))
+		{
+			drawn++;
+		}
+
+		const RectF childClip = (widget.style().overflow() != yoga::Overflow::Visible)
+			? clip.getOverlap(store.get(index).rectWithoutBorder()) : clip;
+
+		for (auto& child : widget.children())
+		{
+			CountCulled(*child, store, childClip, visited, drawn);
+		}
+	}
+
+	JSON PassToJSON(const LayoutBenchmark::PassStats& stats)
+	{
+		JSON json;
+		json[U"median"] = stats.median;
+		json[U"mean"] = stats.mean;
+		json[U"min"] = stats.min;
+		json[U"max"] = stats.max;
+		return json;
+	}
+
+	// 計測の結果を覚えておき、saveから参照する
+	template <class ResultType>
+	LayoutBenchmark::Pass MakePass(String name,
+		std::function<ResultType()> run,
+		std::function<JSON(const ResultType&)> serialize)
+	{
+		auto result = std::make_shared<Optional<ResultType>>();
+
+		return{
+			.name = std::move(name),
+			.run = [=] { *result = run(); },
+			.serialize = [=] { return serialize(result->value()); },
+		};
+	}
+}
+
+LayoutBenchmark::Options LayoutBenchmark::Options::FromCommandLine(const Array<String>& args)
+{
+	Options options;
+
+	for (size_t i = 1; i + 1 < args.size(); i++)
+	{
+		const String& key = args[i];
+		const String& value = args[i + 1];
+
+		if (key == U"--out")
+		{
+			options.outputPath = value;
+		}
+		else if (key == U"--baseline")
+		{
+			options.baselinePath = value;
+		}
+		else if (key == U"--threshold")
+		{
+			options.regressionThreshold = ParseOr<double>(value, options.regressionThreshold);
+		}
+		else if (key == U"--iterations")
+		{
+			options.iterations = ParseOr<size_t>(value, options.iterations);
+		}
+		else if (key == U"--seed")
+		{
+			options.seed = ParseOr<uint64>(value, options.seed);
+		}
+		else if (key == U"--threads")
+		{
+			options.threadCounts = value.split(U',').map([](const String& s) { return ParseOr<size_t>(s, 1); });
+		}
+		else if (key == U"--max-nodes")
+		{
+			size_t maxNodes = ParseOr<size_t>(value, Largest<size_t>);
+			options.nodeCounts.remove_if([=](size_t n) { return n > maxNodes; });
+		}
+		else
+		{
+			continue;
+		}
+
+		i++;
+	}
+
+	return options;
+}
+
+LayoutBenchmark::PassStats LayoutBenchmark::PassStats::FromSamples(Array<double> samples)
+{
+	if (samples.empty())
+	{
+		return{ };
+	}
+
+	samples.sort();
+
+	return{
+		.median = samples[samples.size() / 2],
+		.mean = samples.sum() / samples.size(),
+		.min = samples.front(),
+		.max = samples.back(),
+	};
+}
+
+Array<LayoutBenchmark::Result> LayoutBenchmark::run()
+{
+	Array<Result> results;
+
+	for (auto shape : m_options.shapes)
+	{
+		for (auto nodeCount : m_options.nodeCounts)
+		{
+			for (auto scenario : m_options.scenarios)
+			{
+				auto result = measure(shape, scenario, nodeCount);
+
+				Console << U"{:<10} {:<12} {:>8} nodes: construct {:.1f}us, calculateLayout {:.1f}us, updateLayoutResults {:.1f}us"_fmt(
+					ToString(shape), ToString(scenario), nodeCount,
+					result.construct.median, result.calculateLayout.median, result.updateLayoutResults.median);
+
+				results.push_back(result);
+			}
+		}
+	}
+
+	return results;
+}
+
+Array<LayoutBenchmark::ScalingResult> LayoutBenchmark::runScaling()
+{
+	Array<size_t> threadCounts = m_options.threadCounts;
+	if (threadCounts.empty())
+	{
+		const size_t hardwareThreads = Max<size_t>(std::thread::hardware_concurrency(), 1);
+		for (size_t n = 1; n < hardwareThreads; n *= 2)
+		{
+			threadCounts.push_back(n);
+		}
+		threadCounts.push_back(hardwareThreads);
+	}
+
+	Array<std::shared_ptr<Widget>> roots;
+	Array<std::unique_ptr<LayoutTree>> trees;
+	Array<LayoutTree::LayoutRequest> requests;
+
+	for (size_t i = 0; i < m_options.parallelTreeCount; i++)
+	{
+		roots.push_back(CreateTree(Shape::TextGrid, m_options.parallelTreeNodes));
+		trees.push_back(std::make_unique<LayoutTree>(roots.back()));
+		trees.back()->setLayoutCacheCapacity(0);
+		requests.push_back({ trees.back().get(), m_options.viewportSize });
+	}
+
+	// 初回のレイアウトは計測しない
+	LayoutTree::CalculateLayouts(requests);
+
+	Array<ScalingResult> results;
+	double serialMedian = 0;
+
+	for (auto threads : threadCounts)
+	{
+		LayoutWorkerPool pool{ threads };
+		Array<double> samples;
+
+		for (size_t i = 0; i < m_options.iterations; i++)
+		{
+			// 毎回サイズを変えて全体を計算し直させる
+			const SizeF size = m_options.viewportSize.movedBy(i % 2 == 0 ? -100 : 0, 0);
+			for (auto& request : requests)
+			{
+				request.size = size;
+			}
+
+			Stopwatch sw{ StartImmediately::Yes };
+			LayoutTree::CalculateLayouts(requests, pool);
+			samples.push_back(sw.usF());
+		}
+
+		auto stats = PassStats::FromSamples(std::move(samples));
+		if (results.empty())
+		{
+			serialMedian = stats.median;
+		}
+
+		results.push_back({
+			.threads = threads,
+			.trees = m_options.parallelTreeCount,
+			.nodesPerTree = m_options.parallelTreeNodes,
+			.batch = stats,
+			.speedup = stats.median > 0 ? serialMedian / stats.median : 0,
+		});
+
+		Console << U"CalculateLayouts {} trees x {} nodes, {:>2} threads: {:.1f}us (x{:.2f})"_fmt(
+			m_options.parallelTreeCount, m_options.parallelTreeNodes, threads, stats.median, results.back().speedup);
+	}
+
+	return results;
+}
+
+LayoutBenchmark::SubtreeResult LayoutBenchmark::runSubtrees()
+{
+	auto& pool = LayoutWorkerPool::Default();
+	const size_t nodeCount = m_options.parallelSubtreeNodes;
+
+	auto serialRoot = CreateTree(Shape::Cards, nodeCount);
+	auto parallelRoot = CreateTree(Shape::Cards, nodeCount);
+	auto serialLabels = CollectLabels(*serialRoot);
+	auto parallelLabels = CollectLabels(*parallelRoot);
+
+	LayoutTree serialTree{ serialRoot };
+	LayoutTree parallelTree{ parallelRoot };
+	parallelTree.setParallelLayout(&pool);
+
+	const float width = static_cast<float>(m_options.viewportSize.x);
+	const float height = static_cast<float>(m_options.viewportSize.y);
+
+	// 初回は境界の大きさが分からないので並列にならない
+	serialTree.calculateLayout(width, height);
+	parallelTree.calculateLayout(width, height);
+
+	SmallRNG rng{ m_options.seed };
+	Array<double> serialSamples, parallelSamples;
+
+	for (size_t i = 0; i < m_options.iterations; i++)
+	{
+		// 両方のツリーの同じLabelを書き換えて、多くのカードを汚す
+		{
+			LayoutTree::Batch serialBatch{ serialTree };
+			LayoutTree::Batch parallelBatch{ parallelTree };
+
+			for (size_t k = 0; k < Max<size_t>(serialLabels.size() / 16, 1); k++)
+			{
+				const size_t index = Random(serialLabels.size() - 1, rng);
+				const String text = U"Edited {} {}"_fmt(i, String(static_cast<size_t>(Random(1, 20, rng)), U'#'));
+				serialLabels[index]->setText(text);
+				parallelLabels[index]->setText(text);
+			}
+		}
+
+		Stopwatch sw{ StartImmediately::Yes };
+		serialTree.calculateLayout(width, height);
+		serialSamples.push_back(sw.usF());
+
+		sw.restart();
+		parallelTree.calculateLayout(width, height);
+		parallelSamples.push_back(sw.usF());
+	}
+
+	SubtreeResult result{
+		.threads = pool.threadCount(),
+		.nodeCount = nodeCount,
+		.serial = PassStats::FromSamples(std::move(serialSamples)),
+		.parallel = PassStats::FromSamples(std::move(parallelSamples)),
+	};
+
+	Console << U"Cards {} nodes, {} threads: serial {:.1f}us, parallel {:.1f}us"_fmt(
+		nodeCount, result.threads, result.serial.median, result.parallel.median);
+
+	return result;
+}
+
+LayoutBenchmark::StartupResult LayoutBenchmark::runStartup()
+{
+	const size_t nodeCount = m_options.startupNodes;
+	const FilePath path = FileSystem::PathAppend(FileSystem::TemporaryDirectoryPath(), U"layout_benchmark.snapshot");
+	const float width = static_cast<float>(m_options.viewportSize.x);
+	const float height = static_cast<float>(m_options.viewportSize.y);
+
+	{
+		auto root = CreateTree(Shape::TextGrid, nodeCount);
+		LayoutTree tree{ root };
+		tree.calculateLayout(width, height);
+		WidgetSnapshot::Save(path, *root, m_options.viewportSize);
+	}
+
+	Array<double> coldSamples, openSamples, instantiateSamples;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		Stopwatch sw{ StartImmediately::Yes };
+		{
+			auto root = CreateTree(Shape::TextGrid, nodeCount);
+			LayoutTree tree{ root };
+			tree.calculateLayout(width, height);
+		}
+		coldSamples.push_back(sw.usF());
+
+		sw.restart();
+		WidgetSnapshot snapshot{ path };
+		double sum = 0;
+		for (size_t k = 0; k < snapshot.nodeCount(); k++)
+		{
+			if (auto layout = snapshot.layoutResults(k))
+			{
+				sum += layout->rect().w;
+			}
+		}
+		openSamples.push_back(sw.usF());
+
+		// 読んだ結果を使わないと最適化で読み込みごと消える
+		[[maybe_unused]] volatile double sink = sum;
+
+		sw.restart();
+		auto root = snapshot.instantiate();
+		LayoutTree tree{ root };
+		tree.calculateLayout(width, height);
+		instantiateSamples.push_back(sw.usF());
+	}
+
+	StartupResult result{
+		.nodeCount = nodeCount,
+		.fileBytes = static_cast<size_t>(FileSystem::FileSize(path)),
+		.cold = PassStats::FromSamples(std::move(coldSamples)),
+		.snapshotOpen = PassStats::FromSamples(std::move(openSamples)),
+		.snapshotInstantiate = PassStats::FromSamples(std::move(instantiateSamples)),
+	};
+
+	FileSystem::Remove(path);
+
+	Console << U"Startup {} nodes ({} bytes): cold {:.1f}us, snapshot open {:.1f}us, snapshot instantiate {:.1f}us"_fmt(
+		nodeCount, result.fileBytes, result.cold.median, result.snapshotOpen.median, result.snapshotInstantiate.median);
+
+	return result;
+}
+
+LayoutBenchmark::LoaderResult LayoutBenchmark::runLoader()
+{
+	const FilePath path = FileSystem::PathAppend(FileSystem::TemporaryDirectoryPath(), U"layout_benchmark_tree.json");
+
+	size_t nodeCount = 0;
+	{
+		auto root = CreateTree(Shape::TextGrid, m_options.loaderNodes);
+		// Label以外は全て子を持てる
+		nodeCount = CollectContainers(*root).size() + CollectLabels(*root).size();
+		WidgetTreeLoader::Save(path, *root);
+	}
+
+	WidgetTreeLoader loader;
+	Array<double> parseSamples, loadSamples;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		loader.parse(path);
+		parseSamples.push_back(loader.stats().microseconds);
+
+		// 読み込んだツリーの破棄は計測に含めない
+		auto root = loader.load(path);
+		loadSamples.push_back(loader.stats().microseconds);
+	}
+
+	if (not loader.error().isEmpty())
+	{
+		Console << U"WidgetTreeLoader: {}"_fmt(loader.error());
+	}
+
+	const size_t fileBytes = static_cast<size_t>(FileSystem::FileSize(path));
+	FileSystem::Remove(path);
+
+	auto parse = PassStats::FromSamples(std::move(parseSamples));
+	auto load = PassStats::FromSamples(std::move(loadSamples));
+
+	auto perSecond = [](double amount, double microseconds) { return microseconds > 0 ? amount / microseconds * 1e6 : 0; };
+
+	LoaderResult result{
+		.nodeCount = nodeCount,
+		.fileBytes = fileBytes,
+		.parse = parse,
+		.load = load,
+		.parseNodesPerSecond = perSecond(static_cast<double>(nodeCount), parse.median),
+		.parseMegabytesPerSecond = perSecond(fileBytes / 1e6, parse.median),
+		.loadNodesPerSecond = perSecond(static_cast<double>(nodeCount), load.median),
+		.loadMegabytesPerSecond = perSecond(fileBytes / 1e6, load.median),
+	};
+
+	Console << U"Loader {} nodes ({} bytes): parse {:.1f}us ({:.0f} nodes/s, {:.1f} MB/s), load {:.1f}us ({:.0f} nodes/s, {:.1f} MB/s)"_fmt(
+		nodeCount, fileBytes,
+		parse.median, result.parseNodesPerSecond, result.parseMegabytesPerSecond,
+		load.median, result.loadNodesPerSecond, result.loadMegabytesPerSecond);
+
+	return result;
+}
+
+LayoutBenchmark::TraversalResult LayoutBenchmark::runTraversal()
+{
+	const auto root = CreateTree(Shape::Balanced, m_options.traversalNodes);
+	const auto listRoot = CreateListTree(root);
+
+	Array<double> listSamples, contiguousSamples;
+	size_t visited = 0;
+
+	for (size_t i = 0; i < iterationsFor(m_options.traversalNodes); i++)
+	{
+		Stopwatch sw{ StartImmediately::Yes };
+		visited += TraverseList(listRoot);
+		listSamples.push_back(sw.usF());
+
+		sw.restart();
+		visited += TraverseContiguous(root);
+		contiguousSamples.push_back(sw.usF());
+	}
+
+	TraversalResult result{
+		.nodeCount = m_options.traversalNodes,
+		.list = PassStats::FromSamples(std::move(listSamples)),
+		.contiguous = PassStats::FromSamples(std::move(contiguousSamples)),
+	};
+	result.speedup = result.contiguous.median > 0 ? result.list.median / result.contiguous.median : 0;
+
+	// visitedは最適化で辿る処理が消されないようにするためのもの
+	Console << U"Traversal {} nodes: list {:.1f}us, contiguous {:.1f}us ({:.2f}x, visited {})"_fmt(
+		result.nodeCount, result.list.median, result.contiguous.median, result.speedup, visited);
+
+	return result;
+}
+
+LayoutBenchmark::AllocationResult LayoutBenchmark::runAllocation()
+{
+	const size_t nodeCount = m_options.allocationNodes;
+	const auto pool = std::make_shared<WidgetPool>();
+
+	Array<double> heapBuildSamples, heapTeardownSamples, poolBuildSamples, poolTeardownSamples;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		Stopwatch sw{ StartImmediately::Yes };
+		auto heapRoot = CreateTree(Shape::TextGrid, nodeCount);
+		heapBuildSamples.push_back(sw.usF());
+
+		sw.restart();
+		heapRoot.reset();
+		heapTeardownSamples.push_back(sw.usF());
+
+		sw.restart();
+		auto poolRoot = CreateTree(Shape::TextGrid, nodeCount, pool.get());
+		poolBuildSamples.push_back(sw.usF());
+
+		sw.restart();
+		poolRoot.reset();
+		poolTeardownSamples.push_back(sw.usF());
+	}
+
+	AllocationResult result{
+		.nodeCount = nodeCount,
+		.heapBuild = PassStats::FromSamples(std::move(heapBuildSamples)),
+		.heapTeardown = PassStats::FromSamples(std::move(heapTeardownSamples)),
+		.poolBuild = PassStats::FromSamples(std::move(poolBuildSamples)),
+		.poolTeardown = PassStats::FromSamples(std::move(poolTeardownSamples)),
+		.poolStats = pool->stats(),
+	};
+
+	Console << U"Allocation {} nodes: make_shared build {:.1f}us teardown {:.1f}us, pool build {:.1f}us teardown {:.1f}us ({} slabs, {} recycled buffers)"_fmt(
+		nodeCount, result.heapBuild.median, result.heapTeardown.median, result.poolBuild.median, result.poolTeardown.median,
+		result.poolStats.slabs, result.poolStats.recycledBuffers);
+
+	return result;
+}
+
+LayoutBenchmark::QueryResult LayoutBenchmark::runQuery()
+{
+	const size_t nodeCount = m_options.queryNodes;
+	const auto root = CreateTree(Shape::WideList, nodeCount);
+
+	size_t index = 0;
+	for (auto& child : root->children())
+	{
+		child->setName(index++ % Max<size_t>(m_options.queryMatchInterval, 1) == 0 ? U"red" : U"row");
+	}
+
+	// 結果の配列は使い回し、検索そのものだけを測る
+	Array<std::shared_ptr<Widget>> result;
+	Array<double> traversalSamples, indexedSamples;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		result.clear();
+		Stopwatch sw{ StartImmediately::Yes };
+		root->queryAll(U"red", result);
+		traversalSamples.push_back(sw.usF());
+	}
+
+	const size_t matches = result.size();
+
+	LayoutTree tree{ root };
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		result.clear();
+		Stopwatch sw{ StartImmediately::Yes };
+		root->queryAll(U"red", result);
+		indexedSamples.push_back(sw.usF());
+	}
+
+	QueryResult queryResult{
+		.nodeCount = nodeCount,
+		.matches = matches,
+		.traversal = PassStats::FromSamples(std::move(traversalSamples)),
+		.indexed = PassStats::FromSamples(std::move(indexedSamples)),
+	};
+
+	Console << U"Query {} nodes, {} matches: traversal {:.1f}us, indexed {:.1f}us"_fmt(
+		nodeCount, matches, queryResult.traversal.median, queryResult.indexed.median);
+
+	return queryResult;
+}
+
+LayoutBenchmark::SelectorResult LayoutBenchmark::runSelector()
+{
+	const size_t nodeCount = m_options.selectorNodes;
+	const auto root = CreateTree(Shape::Cards, nodeCount);
+	LayoutTree tree{ root };
+
+	Array<Widget*> uncachedResult;
+	Array<double> uncachedSamples, cachedSamples;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		uncachedResult.clear();
+		Stopwatch sw{ StartImmediately::Yes };
+		if (auto selector = Selector::Compile(m_options.selector))
+		{
+			selector->queryAll(*root, uncachedResult);
+		}
+		uncachedSamples.push_back(sw.usF());
+
+		// 最初の1回は探し、以降は構成が変わらないのでキャッシュから返る
+		sw.restart();
+		tree.select(m_options.selector);
+		cachedSamples.push_back(sw.usF());
+	}
+
+	SelectorResult result{
+		.nodeCount = nodeCount,
+		.matches = uncachedResult.size(),
+		.uncached = PassStats::FromSamples(std::move(uncachedSamples)),
+		.cached = PassStats::FromSamples(std::move(cachedSamples)),
+	};
+
+	Console << U"Selector \"{}\" {} nodes, {} matches: uncached {:.1f}us, cached {:.1f}us ({} hits, {} misses)"_fmt(
+		m_options.selector, nodeCount, result.matches, result.uncached.median, result.cached.median,
+		tree.selectorCacheStats().hits, tree.selectorCacheStats().misses);
+
+	return result;
+}
+
+LayoutBenchmark::IdLookupResult LayoutBenchmark::runIdLookup()
+{
+	const size_t nodeCount = m_options.idLookupNodes;
+	const auto root = CreateTree(Shape::Balanced, nodeCount);
+	LayoutTree tree{ root };
+
+	SmallRNG rng{ m_options.seed };
+	const auto containers = CollectContainers(*root);
+
+	Array<int64> ids(m_options.idLookups);
+	Array<double> walkSamples, slotMapSamples;
+	size_t found = 0;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		for (auto& id : ids)
+		{
+			id = containers[Random(containers.size() - 1, rng)]->id();
+		}
+
+		Stopwatch sw{ StartImmediately::Yes };
+		for (auto id : ids)
+		{
+			found += (FindById(*root, id) != nullptr);
+		}
+		walkSamples.push_back(sw.usF());
+
+		sw.restart();
+		for (auto id : ids)
+		{
+			found += (tree.find(id) != nullptr);
+		}
+		slotMapSamples.push_back(sw.usF());
+	}
+
+	IdLookupResult result{
+		.nodeCount = nodeCount,
+		.lookups = ids.size(),
+		.walk = PassStats::FromSamples(std::move(walkSamples)),
+		.slotMap = PassStats::FromSamples(std::move(slotMapSamples)),
+	};
+
+	// foundは最適化で検索が消されないようにするためのもの
+	Console << U"Id lookup {} nodes, {} lookups: walk {:.1f}us, slot map {:.1f}us (found {})"_fmt(
+		nodeCount, result.lookups, result.walk.median, result.slotMap.median, found);
+
+	return result;
+}
+
+LayoutBenchmark::HitTestResult LayoutBenchmark::runHitTest()
+{
+	const size_t nodeCount = m_options.hitTestNodes;
+	const auto root = CreateTree(Shape::Cards, nodeCount);
+	LayoutTree tree{ root };
+	tree.calculateLayout(static_cast<float>(m_options.viewportSize.x), static_cast<float>(m_options.viewportSize.y));
+
+	// 画面外に並んだWidgetにも当たるよう、内容全体から点を選ぶ
+	RectF bounds{ m_options.viewportSize };
+	for (auto widget : CollectContainers(*root))
+	{
+		if (auto layout = widget->layoutResults())
+		{
+			const RectF rect = layout->rect();
+			const Vec2 tl{ Min(bounds.x, rect.x), Min(bounds.y, rect.y) };
+			const Vec2 br{ Max(bounds.br().x, rect.br().x), Max(bounds.br().y, rect.br().y) };
+			bounds = RectF{ tl, (br - tl) };
+		}
+	}
+
+	SmallRNG rng{ m_options.seed };
+	Array<Vec2> points(m_options.hitTestPoints);
+	Array<Widget*> expected(points.size()), actual(points.size());
+	Array<double> recursiveSamples, indexedSamples, rebuildSamples, cachedSamples;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		for (auto& point : points)
+		{
+			point = RandomVec2(bounds, rng);
+		}
+
+		Stopwatch sw{ StartImmediately::Yes };
+		for (auto [k, point] : Indexed(points))
+		{
+			expected[k] = HitTestRecursive(*root, point);
+		}
+		recursiveSamples.push_back(sw.usF());
+
+		tree.recordStructureChange();
+		sw.restart();
+		tree.hitTest(points.front());
+		rebuildSamples.push_back(sw.usF());
+
+		sw.restart();
+		for (auto [k, point] : Indexed(points))
+		{
+			actual[k] = tree.hitTest(point);
+		}
+		indexedSamples.push_back(sw.usF());
+
+		sw.restart();
+		for (size_t k = 0; k < points.size(); k++)
+		{
+			actual.back() = tree.hitTest(points.back());
+		}
+		cachedSamples.push_back(sw.usF());
+	}
+
+	HitTestResult result{
+		.nodeCount = nodeCount,
+		.points = points.size(),
+		.recursive = PassStats::FromSamples(std::move(recursiveSamples)),
+		.indexed = PassStats::FromSamples(std::move(indexedSamples)),
+		.rebuild = PassStats::FromSamples(std::move(rebuildSamples)),
+		.cached = PassStats::FromSamples(std::move(cachedSamples)),
+	};
+
+	Console << U"Hit test {} nodes, {} points: recursive {:.1f}us, indexed {:.1f}us (rebuild {:.1f}us), cached {:.1f}us"_fmt(
+		nodeCount, result.points, result.recursive.median, result.indexed.median, result.rebuild.median, result.cached.median);
+
+	return result;
+}
+
+LayoutBenchmark::CullingResult LayoutBenchmark::runCulling()
+{
+	const size_t nodeCount = m_options.cullingNodes;
+	const auto root = CreateTree(Shape::Cards, nodeCount);
+
+	// 半分のカードは、はみ出した文字を切り抜く
+	for (auto [i, card] : Indexed(root->children()))
+	{
+		if (i % 2 == 0)
+		{
+			card->style().setOverflow(yoga::Overflow::Hidden);
+		}
+	}
+
+	auto labels = CollectLabels(*root);
+	LayoutTree tree{ root };
+
+	const float width = static_cast<float>(m_options.viewportSize.x);
+	const float height = static_cast<float>(m_options.viewportSize.y);
+	tree.calculateLayout(width, height);
+
+	const RectF viewport{ m_options.viewportSize };
+	SmallRNG rng{ m_options.seed };
+	Array<double> fullSamples, culledSamples;
+	size_t visited = 0, drawn = 0, total = 0;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		// カードの中だけをレイアウトし直させ、祖先へ範囲を広げる経路を通す
+		{
+			LayoutTree::Batch batch{ tree };
+
+			for (size_t k = 0; k < Max<size_t>(labels.size() / 64, 1); k++)
+			{
+				const size_t index = Random(labels.size() - 1, rng);
+				labels[index]->setText(U"Edited {} {}"_fmt(i, String(static_cast<size_t>(Random(1, 80, rng)), U'#')));
+			}
+		}
+		tree.calculateLayout(width, height);
+
+		const auto& store = tree.layoutResultsStore();
+
+		Stopwatch sw{ StartImmediately::Yes };
+		total = CountAll(*root);
+		fullSamples.push_back(sw.usF());
+
+		sw.restart();
+		visited = drawn = 0;
+		CountCulled(*root, store, viewport, visited, drawn);
+		culledSamples.push_back(sw.usF());
+	}
+
+	CullingResult result{
+		.nodeCount = total,
+		.visited = visited,
+		.drawn = drawn,
+		.full = PassStats::FromSamples(std::move(fullSamples)),
+		.culled = PassStats::FromSamples(std::move(culledSamples)),
+	};
+
+	Console << U"Culling {} nodes: {} visited, {} drawn, full {:.1f}us, culled {:.1f}us"_fmt(
+		total, visited, drawn, result.full.median, result.culled.median);
+
+	return result;
+}
+
+LayoutBenchmark::BoxResult LayoutBenchmark::runBox()
+{
+	const size_t nodeCount = m_options.boxNodes;
+	const auto root = CreateTree(Shape::Cards, nodeCount);
+	LayoutTree tree{ root };
+	tree.calculateLayout(static_cast<float>(m_options.viewportSize.x), static_cast<float>(m_options.viewportSize.y));
+
+	// WidgetTreeEditorと同じく、margin、border、paddingの3つの枠
+	struct Frame
+	{
+		RectF outer;
+
+		RectF inner;
+
+		Thickness widths;
+	};
+
+	Array<Frame> frames;
+	const auto& store = tree.layoutResultsStore();
+
+	for (uint32 index = 0; index < store.capacity(); index++)
+	{
+		if (not store.hasResults(index))
+		{
+			continue;
+		}
+
+		const auto layout = store.get(index);
+		frames.push_back({ layout.outerRect(), layout.rect(), layout.margin });
+		frames.push_back({ layout.rect(), layout.rectWithoutBorder(), layout.border });
+		frames.push_back({ layout.rectWithoutBorder(), layout.innerRect(), layout.padding });
+	}
+
+	Array<double> subtractSamples, edgeSamples;
+	Array<double> subtractAreas(frames.size()), edgeAreas(frames.size());
+	size_t polygons = 0, quads = 0;
+
+	for (size_t i = 0; i < iterationsFor(nodeCount); i++)
+	{
+		polygons = quads = 0;
+
+		Stopwatch sw{ StartImmediately::Yes };
+		for (auto [k, frame] : Indexed(frames))
+		{
+			double area = 0;
+			for (const auto& polygon : Geometry2D::Subtract(frame.outer.asPolygon(), frame.inner))
+			{
+				area += polygon.area();
+				polygons++;
+			}
+			subtractAreas[k] = area;
+		}
+		subtractSamples.push_back(sw.usF());
+
+		sw.restart();
+		for (auto [k, frame] : Indexed(frames))
+		{
+			double area = 0;
+			for (const auto& edge : BoxRenderer::FrameEdges(frame.outer, frame.widths))
+			{
+				if (0 < edge.w && 0 < edge.h)
+				{
+					area += edge.area();
+					quads++;
+				}
+			}
+			edgeAreas[k] = area;
+		}
+		edgeSamples.push_back(sw.usF());
+	}
+
+	BoxResult result{
+		.nodeCount = nodeCount,
+		.polygons = polygons,
+		.quads = quads,
+		.subtract = PassStats::FromSamples(std::move(subtractSamples)),
+		.edges = PassStats::FromSamples(std::move(edgeSamples)),
+	};
+
+	Console << U"Box frames {} nodes: subtract {:.1f}us ({} polygons), edges {:.1f}us ({} quads)"_fmt(
+		nodeCount, result.subtract.median, polygons, result.edges.median, quads);
+
+	return result;
+}
+
+LayoutBenchmark::Result LayoutBenchmark::measure(Shape shape, Scenario scenario, size_t nodeCount)
+{
+	SmallRNG rng{ m_options.seed };
+
+	auto root = CreateTree(shape, nodeCount);
+	auto containers = CollectContainers(*root);
+	auto labels = CollectLabels(*root);
+	Array<Edit> edits;
+
+	LayoutTree tree{ root };
+	SizeF size = m_options.viewportSize;
+
+	// 初回のレイアウトは計測しない
+	tree.calculateLayout(static_cast<float>(size.x), static_cast<float>(size.y));
+
+	const size_t iterations = iterationsFor(nodeCount);
+	Array<double> constructSamples, calculateSamples, updateSamples;
+
+	for (size_t i = 0; i < iterations; i++)
+	{
+		switch (scenario)
+		{
+		case Scenario::Steady:
+			break;
+
+		case Scenario::RandomEdits:
+			applyRandomEdit(rng, containers, edits);
+			if (not labels.empty())
+			{
+				labels[Random(labels.size() - 1, rng)]->setText(U"Edited {}"_fmt(i));
+			}
+			break;
+
+		case Scenario::Resize:
+			size = m_options.viewportSize.movedBy(Random(-200.0, 200.0, rng), Random(-200.0, 200.0, rng));
+			break;
+		}
+
+		Stopwatch sw{ StartImmediately::Yes };
+		tree.construct(root);
+		constructSamples.push_back(sw.usF());
+
+		sw.restart();
+		tree.calculateNodeLayout(static_cast<float>(size.x), static_cast<float>(size.y));
+		calculateSamples.push_back(sw.usF());
+
+		sw.restart();
+		tree.updateLayoutResults();
+		updateSamples.push_back(sw.usF());
+	}
+
+	return{
+		.shape = shape,
+		.scenario = scenario,
+		.nodeCount = nodeCount,
+		.iterations = iterations,
+		.construct = PassStats::FromSamples(std::move(constructSamples)),
+		.calculateLayout = PassStats::FromSamples(std::move(calculateSamples)),
+		.updateLayoutResults = PassStats::FromSamples(std::move(updateSamples)),
+	};
+}
+
+void LayoutBenchmark::applyRandomEdit(SmallRNG& rng, const Array<Widget*>& containers, Array<Edit>& edits)
+{
+	// 追加と削除を交互に行いノード数を保つ
+	if (not edits.empty() && RandomBool(0.5, rng))
+	{
+		size_t index = Random(edits.size() - 1, rng);
+		auto& edit = edits[index];
+		edit.parent->removeChild(edit.child);
+		edits.remove_at(index);
+		return;
+	}
+
+	Widget* parent = containers[Random(containers.size() - 1, rng)];
+	auto child = CreateBox(static_cast<float>(Random(10, 50, rng)), static_cast<float>(Random(10, 50, rng)));
+
+	parent->insertChild(Random(parent->children().size(), rng), child);
+
+	edits.push_back({ parent, std::move(child) });
+}
+
+size_t LayoutBenchmark::iterationsFor(size_t nodeCount) const
+{
+	// 大きなツリーは試行回数を減らす
+	return Clamp<size_t>(m_options.iterations * 10'000 / Max<size_t>(nodeCount, 1), 3, m_options.iterations);
+}
+
+std::shared_ptr<Widget> LayoutBenchmark::CreateTree(Shape shape, size_t nodeCount, WidgetPool* pool)
+{
+	auto root = WidgetPool::Create<Widget>(pool);
+
+	switch (shape)
+	{
+	case Shape::DeepChain: BuildDeepChain(*root, nodeCount, pool); break;
+	case Shape::WideList: BuildWideList(*root, nodeCount, pool); break;
+	case Shape::Balanced: BuildBalanced(*root, nodeCount, pool); break;
+	case Shape::TextGrid: BuildTextGrid(*root, nodeCount, pool); break;
+	case Shape::Cards: BuildCards(*root, nodeCount, pool); break;
+	}
+
+	return root;
+}
+
+Array<LayoutBenchmark::Pass> LayoutBenchmark::passes()
+{
+	Array<Pass> passes;
+
+	passes << MakePass<Array<ScalingResult>>(U"scaling",
+		[this] { return runScaling(); },
+		[](const Array<ScalingResult>& scaling)
+		{
+			JSON scalingArray = Array<JSON>{ };
+			for (auto& result : scaling)
+			{
+				JSON item;
+				item[U"threads"] = result.threads;
+				item[U"trees"] = result.trees;
+				item[U"nodesPerTree"] = result.nodesPerTree;
+				item[U"batch"] = PassToJSON(result.batch);
+				item[U"speedup"] = result.speedup;
+				scalingArray.push_back(item);
+			}
+			return scalingArray;
+		});
+
+	passes << MakePass<SubtreeResult>(U"subtrees",
+		[this] { return runSubtrees(); },
+		[](const SubtreeResult& subtrees)
+		{
+			JSON item;
+			item[U"threads"] = subtrees.threads;
+			item[U"nodeCount"] = subtrees.nodeCount;
+			item[U"serial"] = PassToJSON(subtrees.serial);
+			item[U"parallel"] = PassToJSON(subtrees.parallel);
+			return item;
+		});
+
+	passes << MakePass<StartupResult>(U"startup",
+		[this] { return runStartup(); },
+		[](const StartupResult& startup)
+		{
+			JSON item;
+			item[U"nodeCount"] = startup.nodeCount;
+			item[U"fileBytes"] = startup.fileBytes;
+			item[U"cold"] = PassToJSON(startup.cold);
+			item[U"snapshotOpen"] = PassToJSON(startup.snapshotOpen);
+			item[U"snapshotInstantiate"] = PassToJSON(startup.snapshotInstantiate);
+			return item;
+		});
+
+	passes << MakePass<LoaderResult>(U"loader",
+		[this] { return runLoader(); },
+		[](const LoaderResult& loader)
+		{
+			JSON item;
+			item[U"nodeCount"] = loader.nodeCount;
+			item[U"fileBytes"] = loader.fileBytes;
+			item[U"parse"] = PassToJSON(loader.parse);
+			item[U"load"] = PassToJSON(loader.load);
+			item[U"parseNodesPerSecond"] = loader.parseNodesPerSecond;
+			item[U"parseMegabytesPerSecond"] = loader.parseMegabytesPerSecond;
+			item[U"loadNodesPerSecond"] = loader.loadNodesPerSecond;
+			item[U"loadMegabytesPerSecond"] = loader.loadMegabytesPerSecond;
+			return item;
+		});
+
+	passes << MakePass<TraversalResult>(U"traversal",
+		[this] { return runTraversal(); },
+		[](const TraversalResult& traversal)
+		{
+			JSON item;
+			item[U"nodeCount"] = traversal.nodeCount;
+			item[U"list"] = PassToJSON(traversal.list);
+			item[U"contiguous"] = PassToJSON(traversal.contiguous);
+			item[U"speedup"] = traversal.speedup;
+			return item;
+		});
+
+	passes << MakePass<AllocationResult>(U"allocation",
+		[this] { return runAllocation(); },
+		[](const AllocationResult& allocation)
+		{
+			JSON item;
+			item[U"nodeCount"] = allocation.nodeCount;
+			item[U"heapBuild"] = PassToJSON(allocation.heapBuild);
+			item[U"heapTeardown"] = PassToJSON(allocation.heapTeardown);
+			item[U"poolBuild"] = PassToJSON(allocation.poolBuild);
+			item[U"poolTeardown"] = PassToJSON(allocation.poolTeardown);
+			item[U"poolSlabs"] = allocation.poolStats.slabs;
+			item[U"poolReservedBytes"] = allocation.poolStats.reservedBytes;
+			item[U"poolRecycledBuffers"] = allocation.poolStats.recycledBuffers;
+			return item;
+		});
+
+	passes << MakePass<QueryResult>(U"query",
+		[this] { return runQuery(); },
+		[](const QueryResult& query)
+		{
+			JSON item;
+			item[U"nodeCount"] = query.nodeCount;
+			item[U"matches"] = query.matches;
+			item[U"traversal"] = PassToJSON(query.traversal);
+			item[U"indexed"] = PassToJSON(query.indexed);
+			return item;
+		});
+
+	passes << MakePass<SelectorResult>(U"selector",
+		[this] { return runSelector(); },
+		[this](const SelectorResult& selector)
+		{
+			JSON item;
+			item[U"selector"] = m_options.selector;
+			item[U"nodeCount"] = selector.nodeCount;
+			item[U"matches"] = selector.matches;
+			item[U"uncached"] = PassToJSON(selector.uncached);
+			item[U"cached"] = PassToJSON(selector.cached);
+			return item;
+		});
+
+	passes << MakePass<IdLookupResult>(U"idLookup",
+		[this] { return runIdLookup(); },
+		[](const IdLookupResult& idLookup)
+		{
+			JSON item;
+			item[U"nodeCount"] = idLookup.nodeCount;
+			item[U"lookups"] = idLookup.lookups;
+			item[U"walk"] = PassToJSON(idLookup.walk);
+			item[U"slotMap"] = PassToJSON(idLookup.slotMap);
+			return item;
+		});
+
+	passes << MakePass<HitTestResult>(U"hitTest",
+		[this] { return runHitTest(); },
+		[](const HitTestResult& hitTest)
+		{
+			JSON item;
+			item[U"nodeCount"] = hitTest.nodeCount;
+			item[U"points"] = hitTest.points;
+			item[U"recursive"] = PassToJSON(hitTest.recursive);
+			item[U"indexed"] = PassToJSON(hitTest.indexed);
+			item[U"rebuild"] = PassToJSON(hitTest.rebuild);
+			item[U"cached"] = PassToJSON(hitTest.cached);
+			return item;
+		});
+
+	passes << MakePass<CullingResult>(U"culling",
+		[this] { return runCulling(); },
+		[](const CullingResult& culling)
+		{
+			JSON item;
+			item[U"nodeCount"] = culling.nodeCount;
+			item[U"visited"] = culling.visited;
+			item[U"drawn"] = culling.drawn;
+			item[U"full"] = PassToJSON(culling.full);
+			item[U"culled"] = PassToJSON(culling.culled);
+			return item;
+		});
+
+	passes << MakePass<BoxResult>(U"box",
+		[this] { return runBox(); },
+		[](const BoxResult& box)
+		{
+			JSON item;
+			item[U"nodeCount"] = box.nodeCount;
+			item[U"polygons"] = box.polygons;
+			item[U"quads"] = box.quads;
+			item[U"subtract"] = PassToJSON(box.subtract);
+			item[U"edges"] = PassToJSON(box.edges);
+			return item;
+		});
+
+	return passes;
+}
+
+bool LayoutBenchmark::save(const Array<Result>& results, const Array<Pass>& passes, const Array<Regression>& regressions) const
+{
+	JSON json;
+	json[U"version"] = 1;
+	json[U"seed"] = m_options.seed;
+	json[U"unit"] = U"us";
+
+	JSON resultArray = Array<JSON>{ };
+	for (auto& result : results)
+	{
+		JSON item;
+		item[U"key"] = ResultKey(result.shape, result.scenario, result.nodeCount);
+		item[U"shape"] = ToString(result.shape);
+		item[U"scenario"] = ToString(result.scenario);
+		item[U"nodeCount"] = result.nodeCount;
+		item[U"iterations"] = result.iterations;
+		item[U"construct"] = PassToJSON(result.construct);
+		item[U"calculateLayout"] = PassToJSON(result.calculateLayout);
+		item[U"updateLayoutResults"] = PassToJSON(result.updateLayoutResults);
+		resultArray.push_back(item);
+	}
+	json[U"results"] = resultArray;
+
+	for (auto& pass : passes)
+	{
+		json[pass.name] = pass.serialize();
+	}
+
+	if (m_options.baselinePath)
+	{
+		JSON regressionArray = Array<JSON>{ };
+		for (auto& regression : regressions)
+		{
+			JSON item;
+			item[U"key"] = regression.key;
+			item[U"pass"] = regression.pass;
+			item[U"baseline"] = regression.baseline;
+			item[U"current"] = regression.current;
+			regressionArray.push_back(item);
+		}
+		json[U"baseline"] = *m_options.baselinePath;
+		json[U"regressions"] = regressionArray;
+	}
+
+	return json.save(m_options.outputPath);
+}
+
+Array<LayoutBenchmark::Regression> LayoutBenchmark::compareWithBaseline(const Array<Result>& results) const
+{
+	Array<Regression> regressions;
+
+	if (not m_options.baselinePath)
+	{
+		return regressions;
+	}
+
+	const JSON baseline = JSON::Load(*m_options.baselinePath);
+	if (not baseline)
+	{
+		Console << U"baseline could not be loaded: {}"_fmt(*m_options.baselinePath);
+		return regressions;
+	}
+
+	HashTable<String, JSON> baselineResults;
+	for (const auto& item : baseline[U"results"].arrayView())
+	{
+		baselineResults.emplace(item[U"key"].getString(), item);
+	}
+
+	for (auto& result : results)
+	{
+		const String key = ResultKey(result.shape, result.scenario, result.nodeCount);
+		auto it = baselineResults.find(key);
+		if (it == baselineResults.end())
+		{
+			continue;
+		}
+
+		auto check = [&](StringView pass, const PassStats& stats)
+			{
+				const double before = it->second[pass][U"median"].get<double>();
+				const double ratio = before > 0 ? stats.median / before : 1.0;
+
+				Console << U"{:<40} {:<20} {:>10.1f}us -> {:>10.1f}us ({:+.1f}%)"_fmt(key, pass, before, stats.median, (ratio - 1.0) * 100);
+
+				if (ratio > 1.0 + m_options.regressionThreshold)
+				{
+					regressions.push_back({ key, String{ pass }, before, stats.median });
+				}
+			};
+
+		check(U"construct", result.construct);
+		check(U"calculateLayout", result.calculateLayout);
+		check(U"updateLayoutResults", result.updateLayoutResults);
+	}
+
+	return regressions;
+}
+
+StringView LayoutBenchmark::ToString(Shape shape)
+{
+	switch (shape)
+	{
+	case Shape::DeepChain: return U"DeepChain";
+	case Shape::WideList: return U"WideList";
+	case Shape::Balanced: return U"Balanced";
+	case Shape::TextGrid: return U"TextGrid";
+	case Shape::Cards: return U"Cards";
+	}
+	return U"";
+}
+
+StringView LayoutBenchmark::ToString(Scenario scenario)
+{
+	switch (scenario)
+	{
+	case Scenario::Steady: return U"Steady";
+	case Scenario::RandomEdits: return U"RandomEdits";
+	case Scenario::Resize: return U"Resize";
+	}
+	return U"";
+}
+
+String LayoutBenchmark::ResultKey(Shape shape, Scenario scenario, size_t nodeCount)
+{
+	return U"{}/{}/{}"_fmt(ToString(shape), ToString(scenario), nodeCount);
+}
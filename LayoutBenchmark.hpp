@@ -0,0 +1,404 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "Widget.hpp"
+#include "LayoutTree.hpp"
+
+// ウィンドウやImGuiを使わずにLayoutTreeの各パスを計測する
+// 結果が正しいかどうかは確かめない (各モジュールの *Test.cpp が確かめる)
+class LayoutBenchmark
+{
+public:
+
+	// 合成するツリーの形
+	enum class Shape
+	{
+		DeepChain,
+		WideList,
+		Balanced,
+		TextGrid,
+		Cards,
+	};
+
+	// 計測中にツリーへ加える変更
+	enum class Scenario
+	{
+		Steady,
+		RandomEdits,
+		Resize,
+	};
+
+	struct Options
+	{
+		Array<Shape> shapes{ Shape::DeepChain, Shape::WideList, Shape::Balanced, Shape::TextGrid, Shape::Cards };
+
+		Array<Scenario> scenarios{ Scenario::Steady, Scenario::RandomEdits, Scenario::Resize };
+
+		Array<size_t> nodeCounts{ 1'000, 10'000, 100'000, 1'000'000 };
+
+		size_t iterations = 20;
+
+		uint64 seed = 12345;
+
+		SizeF viewportSize{ 1280, 720 };
+
+		FilePath outputPath = U"layout_benchmark.json";
+
+		Optional<FilePath> baselinePath;
+
+		// ベースラインより何割遅くなったら退行とみなすか
+		double regressionThreshold = 0.10;
+
+		// LayoutTree::CalculateLayoutsのスケーリング計測 (空の場合は1, 2, 4, ... コア数)
+		Array<size_t> threadCounts;
+
+		size_t parallelTreeCount = 64;
+
+		size_t parallelTreeNodes = 2'000;
+
+		// 1つのLayoutTree内で固定サイズの部分木を並列にレイアウトする計測のノード数
+		size_t parallelSubtreeNodes = 100'000;
+
+		// 起動時間の計測のノード数
+		size_t startupNodes = 10'000;
+
+		// WidgetTreeLoaderの計測のノード数
+		size_t loaderNodes = 100'000;
+
+		// ツリー全体を辿る計測のノード数
+		size_t traversalNodes = 100'000;
+
+		// Widgetの確保と破棄の計測のノード数
+		size_t allocationNodes = 100'000;
+
+		// 名前による検索の計測のノード数と、一致させるWidgetの間隔
+		size_t queryNodes = 100'000;
+
+		size_t queryMatchInterval = 100;
+
+		// セレクタの計測のノード数とセレクタ
+		size_t selectorNodes = 100'000;
+
+		String selector = U"Widget > Label:nth-child(2n+1)";
+
+		// idからWidgetを引く計測のノード数と、1回の計測で引く数
+		size_t idLookupNodes = 100'000;
+
+		size_t idLookups = 100;
+
+		// 当たり判定の計測のノード数と、1回の計測で調べる点の数
+		size_t hitTestNodes = 100'000;
+
+		size_t hitTestPoints = 1'000;
+
+		// 描画の間引きの計測のノード数
+		size_t cullingNodes = 100'000;
+
+		// 枠の分割の計測のノード数
+		size_t boxNodes = 10'000;
+
+		static Options FromCommandLine(const Array<String>& args);
+	};
+
+	// 1パス分の計測結果 (マイクロ秒)
+	struct PassStats
+	{
+		double median = 0;
+
+		double mean = 0;
+
+		double min = 0;
+
+		double max = 0;
+
+		static PassStats FromSamples(Array<double> samples);
+	};
+
+	struct Result
+	{
+		Shape shape;
+
+		Scenario scenario;
+
+		size_t nodeCount;
+
+		size_t iterations;
+
+		PassStats construct;
+
+		PassStats calculateLayout;
+
+		PassStats updateLayoutResults;
+	};
+
+	// 独立したLayoutTreeをまとめて並列にレイアウトした結果
+	struct ScalingResult
+	{
+		size_t threads;
+
+		size_t trees;
+
+		size_t nodesPerTree;
+
+		PassStats batch;
+
+		// 1スレッドの場合に対する速度比
+		double speedup;
+	};
+
+	// 1つのLayoutTree内の部分木を、直列と並列でレイアウトした結果
+	struct SubtreeResult
+	{
+		size_t threads;
+
+		size_t nodeCount;
+
+		PassStats serial;
+
+		PassStats parallel;
+	};
+
+	// 起動から最初のフレームを描けるまでの時間
+	struct StartupResult
+	{
+		size_t nodeCount;
+
+		size_t fileBytes;
+
+		// コードでツリーを作り、constructとcalculateLayoutを行う
+		PassStats cold;
+
+		// スナップショットを開き、全ノードのレイアウト結果を読む
+		PassStats snapshotOpen;
+
+		// スナップショットからツリーを作り、constructとcalculateLayoutを行う
+		PassStats snapshotInstantiate;
+	};
+
+	// WidgetTreeLoaderでJSONから読み込んだ結果
+	struct LoaderResult
+	{
+		size_t nodeCount;
+
+		size_t fileBytes;
+
+		// Widgetを作らずに読むだけ
+		PassStats parse;
+
+		// 読みながらWidgetツリーを組み立てる
+		PassStats load;
+
+		// 中央値から求めた秒間のノード数とMB数
+		double parseNodesPerSecond;
+
+		double parseMegabytesPerSecond;
+
+		double loadNodesPerSecond;
+
+		double loadMegabytesPerSecond;
+	};
+
+	// ツリー全体を辿った結果と、std::listに子を持ち値で受け渡していた以前の辿り方との比較
+	struct TraversalResult
+	{
+		size_t nodeCount;
+
+		PassStats list;
+
+		PassStats contiguous;
+
+		// listに対する速度比 (中央値)
+		double speedup;
+	};
+
+	// ツリーの作成と破棄を、Widgetごとのstd::make_sharedとWidgetPoolで比べた結果
+	struct AllocationResult
+	{
+		size_t nodeCount;
+
+		PassStats heapBuild;
+
+		PassStats heapTeardown;
+
+		// 同じプールで作り直すので、2回目以降は破棄したWidgetの領域と文字列を使い回す
+		PassStats poolBuild;
+
+		PassStats poolTeardown;
+
+		// 計測後のプールの状態
+		WidgetPool::Stats poolStats;
+	};
+
+	// Widget::queryAllを、LayoutTreeに属する前 (全体を辿る) と後 (名前の索引を引く) で比べた結果
+	struct QueryResult
+	{
+		size_t nodeCount;
+
+		size_t matches;
+
+		PassStats traversal;
+
+		PassStats indexed;
+	};
+
+	// 毎回セレクタを解析して探した結果と、LayoutTree::selectのキャッシュから返した結果
+	struct SelectorResult
+	{
+		size_t nodeCount;
+
+		size_t matches;
+
+		PassStats uncached;
+
+		PassStats cached;
+	};
+
+	// idからWidgetを引くのに、ツリーを辿った場合とLayoutTree::findを使った場合
+	struct IdLookupResult
+	{
+		size_t nodeCount;
+
+		size_t lookups;
+
+		PassStats walk;
+
+		PassStats slotMap;
+	};
+
+	// 点の下のWidgetを、全体を再帰で辿って探した場合とLayoutTreeの索引で探した場合
+	struct HitTestResult
+	{
+		size_t nodeCount;
+
+		size_t points;
+
+		PassStats recursive;
+
+		PassStats indexed;
+
+		// 構成が変わった後の索引の作り直し
+		PassStats rebuild;
+
+		// 同じ点をもう一度調べた場合 (前回の結果を返す)
+		PassStats cached;
+	};
+
+	// Widget::drawと同じ規則で、見えている範囲に対して辿るWidgetの数と手間
+	struct CullingResult
+	{
+		size_t nodeCount;
+
+		// 見えている範囲の中で辿ったWidgetと、そのうち枠か内容を描くWidget
+		size_t visited;
+
+		size_t drawn;
+
+		// 全てのWidgetを辿った場合
+		PassStats full;
+
+		PassStats culled;
+	};
+
+	// margin、border、paddingの枠を、多角形の差で求めた場合と辺の四角形で求めた場合
+	struct BoxResult
+	{
+		size_t nodeCount;
+
+		// 差で得た多角形と、辺の四角形の数
+		size_t polygons;
+
+		size_t quads;
+
+		PassStats subtract;
+
+		PassStats edges;
+	};
+
+	struct Regression
+	{
+		String key;
+
+		String pass;
+
+		double baseline;
+
+		double current;
+	};
+
+	// 登録された計測の1つ。runの後にserializeを呼ぶ
+	struct Pass
+	{
+		// 結果を書き出すJSONのキー
+		String name;
+
+		// 計測して結果を覚える
+		std::function<void()> run;
+
+		// 覚えた結果をJSONにする
+		std::function<JSON()> serialize;
+	};
+
+	LayoutBenchmark(const Options& options)
+		: m_options(options) { }
+
+public:
+
+	Array<Result> run();
+
+	Array<ScalingResult> runScaling();
+
+	SubtreeResult runSubtrees();
+
+	StartupResult runStartup();
+
+	LoaderResult runLoader();
+
+	TraversalResult runTraversal();
+
+	AllocationResult runAllocation();
+
+	QueryResult runQuery();
+
+	SelectorResult runSelector();
+
+	IdLookupResult runIdLookup();
+
+	HitTestResult runHitTest();
+
+	CullingResult runCulling();
+
+	BoxResult runBox();
+
+	// run以外の計測を、実行する順に並べる
+	Array<Pass> passes();
+
+	bool save(const Array<Result>& results, const Array<Pass>& passes, const Array<Regression>& regressions) const;
+
+	Array<Regression> compareWithBaseline(const Array<Result>& results) const;
+
+	// poolを渡した場合、Widgetはそこから作る
+	static std::shared_ptr<Widget> CreateTree(Shape shape, size_t nodeCount, WidgetPool* pool = nullptr);
+
+	static StringView ToString(Shape shape);
+
+	static StringView ToString(Scenario scenario);
+
+	static String ResultKey(Shape shape, Scenario scenario, size_t nodeCount);
+
+private:
+
+	// ランダム編集で追加したウィジェットと、その親
+	struct Edit
+	{
+		Widget* parent;
+
+		std::shared_ptr<Widget> child;
+	};
+
+	Options m_options;
+
+	Result measure(Shape shape, Scenario scenario, size_t nodeCount);
+
+	void applyRandomEdit(SmallRNG& rng, const Array<Widget*>& containers, Array<Edit>& edits);
+
+	size_t iterationsFor(size_t nodeCount) const;
+};
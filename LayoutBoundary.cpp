@@ -0,0 +1,177 @@
+﻿#include "LayoutBoundary.hpp"
+#include <yoga/node/Node.h>
+#include <yoga/algorithm/CalculateLayout.h>
+#include <yoga/event/event.h>
+
+using namespace facebook;
+
+namespace
+{
+	constexpr yoga::Edge AllEdges[] = {
+		yoga::Edge::Left,
+		yoga::Edge::Top,
+		yoga::Edge::Right,
+		yoga::Edge::Bottom,
+		yoga::Edge::Start,
+		yoga::Edge::End,
+		yoga::Edge::Horizontal,
+		yoga::Edge::Vertical,
+		yoga::Edge::All,
+	};
+
+	// yogaのレイアウトと重ならない世代番号を使う
+	std::atomic<uint32_t> BoundaryGeneration{ 0x8000'0000u };
+
+	bool IsPoint(yoga::StyleLength value)
+	{
+		return value.unit() == yoga::Unit::Point;
+	}
+
+	// 親の大きさを参照しない長さ
+	bool IsFixed(yoga::StyleLength value)
+	{
+		return value.unit() == yoga::Unit::Point || value.unit() == yoga::Unit::Undefined;
+	}
+
+	bool IsZeroOrUndefined(yoga::FloatOptional value)
+	{
+		return value.isUndefined() || value.unwrap() == 0.0f;
+	}
+
+	// 親がこの子を交差軸で揃える方法
+	yoga::Align EffectiveAlign(const yoga::Node& node)
+	{
+		const auto align = node.getStyle().alignSelf();
+		return (align == yoga::Align::Auto) ? node.getOwner()->getStyle().alignItems() : align;
+	}
+
+	// 一度も親からレイアウトされていなければ条件が分からない
+	bool HasCachedLayout(const yoga::Node& node)
+	{
+		const auto& cached = node.getLayout().cachedLayout;
+
+		return cached.availableWidth >= 0 && cached.availableHeight >= 0 &&
+			not std::isnan(cached.availableWidth) && not std::isnan(cached.availableHeight);
+	}
+}
+
+bool LayoutBoundary::IsBoundary(const yoga::Node& node)
+{
+	const auto& style = node.getStyle();
+
+	if (node.getOwner() == nullptr || style.display() == yoga::Display::None)
+	{
+		return false;
+	}
+
+	for (auto dimension : { yoga::Dimension::Width, yoga::Dimension::Height })
+	{
+		if (not IsPoint(style.dimension(dimension)) ||
+			not IsFixed(style.minDimension(dimension)) ||
+			not IsFixed(style.maxDimension(dimension)))
+		{
+			return false;
+		}
+	}
+
+	// flex-basisが指定されていると主軸の大きさが幅や高さより優先される
+	if (not IsZeroOrUndefined(style.flex()) ||
+		not IsZeroOrUndefined(style.flexGrow()) ||
+		not IsZeroOrUndefined(style.flexShrink()) ||
+		not (style.flexBasis().unit() == yoga::Unit::Auto || style.flexBasis().unit() == yoga::Unit::Undefined))
+	{
+		return false;
+	}
+
+	for (auto edge : AllEdges)
+	{
+		if (not IsFixed(style.margin(edge)) ||
+			not IsFixed(style.padding(edge)) ||
+			not IsFixed(style.border(edge)))
+		{
+			return false;
+		}
+	}
+
+	// ベースラインで揃える場合、中身の変化が自身の位置や兄弟の位置を動かす
+	if (node.hasBaselineFunc() || EffectiveAlign(node) == yoga::Align::Baseline)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool LayoutBoundary::CanRelayout(const yoga::Node& node)
+{
+	return IsBoundary(node) && HasCachedLayout(node);
+}
+
+bool LayoutBoundary::Calculate(yoga::Node& node)
+{
+	if (not HasCachedLayout(node))
+	{
+		return false;
+	}
+
+	const auto& layout = node.getLayout();
+	const auto& cached = layout.cachedLayout;
+
+	yoga::LayoutData layoutData{};
+
+	// yoga::calculateLayoutと同じく、パスの始まりと終わりを知らせる
+	yoga::Event::publish<yoga::Event::LayoutPassStart>(&node);
+
+	yoga::calculateLayoutInternal(
+		&node,
+		cached.availableWidth,
+		cached.availableHeight,
+		layout.lastOwnerDirection,
+		cached.widthSizingMode,
+		cached.heightSizingMode,
+		cached.availableWidth,
+		cached.availableHeight,
+		true,
+		yoga::LayoutPassReason::kInitial,
+		layoutData,
+		0,
+		BoundaryGeneration.fetch_add(1) + 1
+	);
+
+	yoga::Event::publish<yoga::Event::LayoutPassEnd>(&node, { &layoutData });
+
+	return true;
+}
+
+void LayoutBoundary::CollectDirty(yoga::Node& root, Array<yoga::Node*>& boundaries)
+{
+	if (not root.isDirty())
+	{
+		return;
+	}
+
+	Array<yoga::Node*> stack{ &root };
+
+	while (not stack.empty())
+	{
+		yoga::Node* node = stack.back();
+		stack.pop_back();
+
+		for (auto child : node->getChildren())
+		{
+			if (not child->isDirty())
+			{
+				continue;
+			}
+
+			if (IsBoundary(*child))
+			{
+				boundaries.push_back(child);
+			}
+			else
+			{
+				stack.push_back(child);
+			}
+		}
+	}
+}
@@ -0,0 +1,23 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+
+namespace facebook::yoga { class Node; }
+
+// 親や兄弟のレイアウトに依存せず、大きさが自身のスタイルだけで決まるノード(レイアウト境界)を扱う
+class LayoutBoundary
+{
+public:
+
+	// 幅と高さがポイントで固定され、伸縮せず、余白に割合指定がないノード
+	static bool IsBoundary(const facebook::yoga::Node& node);
+
+	// 境界であり、前回親から渡された条件が分かっているので、親を辿らずにレイアウトし直せる
+	static bool CanRelayout(const facebook::yoga::Node& node);
+
+	// 前回親から渡されたのと同じ条件で、nodeとその子孫だけをレイアウトする
+	// 次の親のレイアウトでは同条件のキャッシュとして使われ、条件が変わっていればyogaが計算し直す
+	static bool Calculate(facebook::yoga::Node& node);
+
+	// rootから汚れたノードを辿り、最も外側にある汚れたレイアウト境界を集める
+	static void CollectDirty(facebook::yoga::Node& root, Array<facebook::yoga::Node*>& boundaries);
+};
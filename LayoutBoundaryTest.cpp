@@ -0,0 +1,147 @@
+﻿#include "LayoutBoundary.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+#include "Label.hpp"
+
+namespace
+{
+	// 並列にレイアウトするツリーの大きさと、ベースラインの確認に使うツリーの大きさ
+	constexpr size_t ParallelNodes = 10'000;
+
+	constexpr size_t BaselineNodes = 200;
+
+	constexpr size_t Iterations = 8;
+
+	constexpr float Width = 1280, Height = 720;
+
+	// 2つのツリーのレイアウト結果を比べ、一致しないWidgetの数を返す
+	size_t CountMismatches(const Widget& a, const Widget& b)
+	{
+		size_t mismatches = 0;
+
+		const auto layoutA = a.layoutResults();
+		const auto layoutB = b.layoutResults();
+
+		if (not layoutA || not layoutB ||
+			layoutA->rect() != layoutB->rect() ||
+			layoutA->outerRect() != layoutB->outerRect() ||
+			layoutA->innerRect() != layoutB->innerRect())
+		{
+			mismatches++;
+		}
+
+		if (a.children().size() != b.children().size())
+		{
+			return mismatches + 1;
+		}
+
+		for (auto itA = a.children().begin(), itB = b.children().begin(); itA != a.children().end(); ++itA, ++itB)
+		{
+			mismatches += CountMismatches(**itA, **itB);
+		}
+
+		return mismatches;
+	}
+
+	void CollectLabels(Widget& widget, Array<Label*>& result)
+	{
+		if (auto label = dynamic_cast<Label*>(&widget))
+		{
+			result.push_back(label);
+		}
+
+		for (auto& child : widget.children())
+		{
+			CollectLabels(*child, result);
+		}
+	}
+
+	// 固定サイズのカードを境界として並列にレイアウトした結果を、直列の結果と比べる
+	const UnitTest::Registration ParallelLayoutTest{ U"LayoutBoundary parallel", [](Array<String>& failures)
+		{
+			auto serialRoot = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Cards, ParallelNodes);
+			auto parallelRoot = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Cards, ParallelNodes);
+
+			Array<Label*> serialLabels, parallelLabels;
+			CollectLabels(*serialRoot, serialLabels);
+			CollectLabels(*parallelRoot, parallelLabels);
+
+			LayoutTree serialTree{ serialRoot };
+			LayoutTree parallelTree{ parallelRoot };
+			parallelTree.setParallelLayout(&LayoutWorkerPool::Default());
+
+			// 初回は境界の大きさが分からないので並列にならない
+			serialTree.calculateLayout(Width, Height);
+			parallelTree.calculateLayout(Width, Height);
+
+			SmallRNG rng{ 12345 };
+
+			for (size_t i = 0; i < Iterations; i++)
+			{
+				if (const size_t mismatches = CountMismatches(*serialRoot, *parallelRoot))
+				{
+					failures << U"iteration {}: parallel subtree layout differs from serial layout in {} widgets"_fmt(i, mismatches);
+				}
+
+				// 両方のツリーの同じLabelを書き換えて、多くのカードを汚す
+				{
+					LayoutTree::Batch serialBatch{ serialTree };
+					LayoutTree::Batch parallelBatch{ parallelTree };
+
+					for (size_t k = 0; k < Max<size_t>(serialLabels.size() / 16, 1); k++)
+					{
+						const size_t index = Random(serialLabels.size() - 1, rng);
+						const String text = U"Edited {} {}"_fmt(i, String(static_cast<size_t>(Random(1, 20, rng)), U'#'));
+						serialLabels[index]->setText(text);
+						parallelLabels[index]->setText(text);
+					}
+				}
+
+				serialTree.calculateLayout(Width, Height);
+				parallelTree.calculateLayout(Width, Height);
+			}
+		} };
+
+	// 行をベースラインで揃えると、カードの中身がカード自身の位置を動かす
+	// 境界から計算し直した結果を、同じ編集を済ませてから作ったツリーの全体のレイアウトと比べる
+	const UnitTest::Registration BaselineTest{ U"LayoutBoundary baseline", [](Array<String>& failures)
+		{
+			auto incrementalRoot = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Cards, BaselineNodes);
+			auto fullRoot = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Cards, BaselineNodes);
+			incrementalRoot->style().setAlignItems(facebook::yoga::Align::Baseline);
+			fullRoot->style().setAlignItems(facebook::yoga::Align::Baseline);
+
+			LayoutTree incrementalTree{ incrementalRoot };
+			incrementalTree.calculateLayout(Width, Height);
+
+			auto edit = [&](Widget& root)
+				{
+					// 各カードの先頭のLabelの余白を変え、カードのベースラインをずらす
+					for (auto [i, card] : Indexed(root.children()))
+					{
+						if ((i % 3 == 0) && not card->children().empty())
+						{
+							card->children().front()->style().setPadding(facebook::yoga::Edge::Top, facebook::yoga::Style::Length::points(static_cast<float>(4 + i % 7)));
+							card->children().front()->markLayoutDirty();
+						}
+					}
+				};
+
+			edit(*incrementalRoot);
+			incrementalTree.calculateLayout(Width, Height);
+
+			edit(*fullRoot);
+			LayoutTree fullTree{ fullRoot };
+			fullTree.calculateLayout(Width, Height);
+
+			if (const size_t mismatches = CountMismatches(*incrementalRoot, *fullRoot))
+			{
+				failures << U"boundary relayout under baseline alignment differs from full layout in {} widgets"_fmt(mismatches);
+			}
+		} };
+}
+
+#endif
@@ -0,0 +1,301 @@
+﻿#include "LayoutHitIndex.hpp"
+
+namespace
+{
+	void EraseIndex(Array<uint32>& list, uint32 index)
+	{
+		auto it = std::find(list.begin(), list.end(), index);
+		assert(it != list.end());
+
+		*it = list.back();
+		list.pop_back();
+	}
+}
+
+void LayoutHitIndex::rebuild(const LayoutResultsStore& store, const Array<uint32>& order)
+{
+	clear();
+	m_stats.rebuilds++;
+
+	for (auto [i, index] : Indexed(order))
+	{
+		if (m_entries.size() <= index)
+		{
+			m_entries.resize(index + 1);
+		}
+
+		auto& entry = m_entries[index];
+		entry.order = static_cast<uint32>(i);
+		entry.active = true;
+
+		if (store.hasResults(index))
+		{
+			insert(index, store.rect(index));
+		}
+	}
+}
+
+void LayoutHitIndex::update(const LayoutResultsStore& store, const Array<uint32>& indices)
+{
+	for (auto index : indices)
+	{
+		if (m_entries.size() <= index || not m_entries[index].active)
+		{
+			continue;
+		}
+
+		auto& entry = m_entries[index];
+
+		if (not store.hasResults(index))
+		{
+			remove(index);
+			entry.rect = RectF{ 0, 0, 0, 0 };
+			continue;
+		}
+
+		const RectF rect = store.rect(index);
+
+		// 親が動いて辿られただけで、自身の矩形は変わっていない場合
+		if (entry.rect == rect)
+		{
+			continue;
+		}
+
+		remove(index);
+		insert(index, rect);
+		m_stats.updatedEntries++;
+	}
+}
+
+void LayoutHitIndex::clear()
+{
+	m_entries.clear();
+	m_cells.clear();
+	m_oversized.clear();
+	m_registered = 0;
+	m_cachedPos.reset();
+}
+
+uint32 LayoutHitIndex::hitTest(Vec2 pos)
+{
+	m_stats.queries++;
+
+	if (m_cachedPos == pos)
+	{
+		m_stats.cacheHits++;
+		return m_cachedIndex;
+	}
+
+	uint32 result = InvalidIndex;
+
+	auto test = [&](uint32 index)
+		{
+			const auto& entry = m_entries[index];
+
+			if (entry.rect.intersects(pos) &&
+				(result == InvalidIndex || m_entries[result].order < entry.order))
+			{
+				result = index;
+			}
+		};
+
+	if (auto it = m_cells.find(CellKey(cellCoord(pos.x), cellCoord(pos.y)));
+		it != m_cells.end())
+	{
+		for (auto index : it->second)
+		{
+			test(index);
+		}
+	}
+
+	for (auto index : m_oversized)
+	{
+		test(index);
+	}
+
+	m_cachedPos = pos;
+	m_cachedIndex = result;
+	return result;
+}
+
+void LayoutHitIndex::hitTestAll(Vec2 pos, Array<uint32>& result)
+{
+	m_stats.queries++;
+
+	const size_t begin = result.size();
+
+	if (auto it = m_cells.find(CellKey(cellCoord(pos.x), cellCoord(pos.y)));
+		it != m_cells.end())
+	{
+		for (auto index : it->second)
+		{
+			if (m_entries[index].rect.intersects(pos))
+			{
+				result.push_back(index);
+			}
+		}
+	}
+
+	for (auto index : m_oversized)
+	{
+		if (m_entries[index].rect.intersects(pos))
+		{
+			result.push_back(index);
+		}
+	}
+
+	sortByOrder(result, begin);
+}
+
+void LayoutHitIndex::query(const RectF& rect, Array<uint32>& result)
+{
+	m_stats.queries++;
+
+	const size_t begin = result.size();
+
+	// 印が一周したら付け直す
+	if (++m_stamp == 0)
+	{
+		for (auto& entry : m_entries)
+		{
+			entry.stamp = 0;
+		}
+		m_stamp = 1;
+	}
+
+	auto test = [&](uint32 index)
+		{
+			auto& entry = m_entries[index];
+
+			if (entry.stamp != m_stamp && entry.rect.intersects(rect))
+			{
+				entry.stamp = m_stamp;
+				result.push_back(index);
+			}
+		};
+
+	const CellRange range = cellRange(rect);
+
+	// 登録されているセルより広い範囲は、全てのセルを辿る方が速い
+	if (m_cells.size() < range.count())
+	{
+		for (auto& [key, cell] : m_cells)
+		{
+			for (auto index : cell)
+			{
+				test(index);
+			}
+		}
+	}
+	else
+	{
+		for (int32 y = range.y0; y <= range.y1; y++)
+		{
+			for (int32 x = range.x0; x <= range.x1; x++)
+			{
+				if (auto it = m_cells.find(CellKey(x, y));
+					it != m_cells.end())
+				{
+					for (auto index : it->second)
+					{
+						test(index);
+					}
+				}
+			}
+		}
+	}
+
+	for (auto index : m_oversized)
+	{
+		test(index);
+	}
+
+	sortByOrder(result, begin);
+}
+
+LayoutHitIndex::CellRange LayoutHitIndex::cellRange(const RectF& rect) const noexcept
+{
+	return{
+		.x0 = cellCoord(rect.x),
+		.y0 = cellCoord(rect.y),
+		.x1 = cellCoord(rect.x + rect.w),
+		.y1 = cellCoord(rect.y + rect.h),
+	};
+}
+
+void LayoutHitIndex::insert(uint32 index, const RectF& rect)
+{
+	auto& entry = m_entries[index];
+	assert(not entry.registered);
+
+	m_cachedPos.reset();
+	entry.rect = rect;
+
+	// 大きさのない矩形は点とも矩形とも重ならない
+	if (rect.w <= 0 || rect.h <= 0)
+	{
+		return;
+	}
+
+	entry.cells = cellRange(rect);
+	entry.registered = true;
+	entry.oversized = (MaxCellsPerEntry < entry.cells.count());
+	m_registered++;
+
+	if (entry.oversized)
+	{
+		m_oversized.push_back(index);
+		return;
+	}
+
+	for (int32 y = entry.cells.y0; y <= entry.cells.y1; y++)
+	{
+		for (int32 x = entry.cells.x0; x <= entry.cells.x1; x++)
+		{
+			m_cells[CellKey(x, y)].push_back(index);
+		}
+	}
+}
+
+void LayoutHitIndex::remove(uint32 index)
+{
+	auto& entry = m_entries[index];
+
+	if (not entry.registered)
+	{
+		return;
+	}
+
+	m_cachedPos.reset();
+	entry.registered = false;
+	m_registered--;
+
+	if (entry.oversized)
+	{
+		EraseIndex(m_oversized, index);
+		return;
+	}
+
+	for (int32 y = entry.cells.y0; y <= entry.cells.y1; y++)
+	{
+		for (int32 x = entry.cells.x0; x <= entry.cells.x1; x++)
+		{
+			auto it = m_cells.find(CellKey(x, y));
+			assert(it != m_cells.end());
+
+			EraseIndex(it->second, index);
+
+			// 空のセルは残さない
+			if (it->second.empty())
+			{
+				m_cells.erase(it);
+			}
+		}
+	}
+}
+
+void LayoutHitIndex::sortByOrder(Array<uint32>& result, size_t begin) const
+{
+	std::sort(result.begin() + begin, result.end(),
+		[&](uint32 a, uint32 b) { return m_entries[b].order < m_entries[a].order; });
+}
@@ -0,0 +1,139 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "LayoutResultsStore.hpp"
+
+// レイアウト結果の矩形を一定の大きさのセルに振り分け、点や矩形と重なるノードを引く索引
+// ノードはLayoutResultsStoreの番号で扱い、描画順 (後ほど手前) を保持する
+// 構成が変わったらrebuild、位置や大きさが変わったノードだけならupdateで反映する
+class LayoutHitIndex
+{
+public:
+
+	static constexpr uint32 InvalidIndex = LayoutResultsStore::InvalidIndex;
+
+	struct Stats
+	{
+		// 全体を作り直した回数
+		size_t rebuilds = 0;
+
+		// updateで登録し直したノードの数
+		size_t updatedEntries = 0;
+
+		size_t queries = 0;
+
+		// hitTestで前回の結果を返した回数
+		size_t cacheHits = 0;
+	};
+
+	static constexpr double DefaultCellSize = 64;
+
+	// これより多くのセルにまたがる矩形はセルに載せず、全ての問い合わせで確かめる
+	static constexpr size_t MaxCellsPerEntry = 256;
+
+	explicit LayoutHitIndex(double cellSize = DefaultCellSize)
+		: m_cellSize(cellSize) { }
+
+public:
+
+	// orderは描画順に並べたノードの番号。結果のないノードは結果が入ったupdateで載る
+	void rebuild(const LayoutResultsStore& store, const Array<uint32>& order);
+
+	// rebuildに含まれていたノードの矩形を、storeの結果で置き換える
+	void update(const LayoutResultsStore& store, const Array<uint32>& indices);
+
+	void clear();
+
+	// posを含むノードのうち一番手前のもの。なければInvalidIndex
+	// 前回と同じposで、その後に矩形が変わっていなければ前回の結果を返す
+	uint32 hitTest(Vec2 pos);
+
+	// posを含むノードを手前から順にresultの末尾に追加する
+	void hitTestAll(Vec2 pos, Array<uint32>& result);
+
+	// rectと重なるノードを手前から順にresultの末尾に追加する
+	void query(const RectF& rect, Array<uint32>& result);
+
+	// 索引に載っているノードの数
+	size_t size() const noexcept { return m_registered; }
+
+	const Stats& stats() const noexcept { return m_stats; }
+
+	void resetStats() noexcept { m_stats = { }; }
+
+private:
+
+	struct CellRange
+	{
+		int32 x0 = 0;
+
+		int32 y0 = 0;
+
+		int32 x1 = -1;
+
+		int32 y1 = -1;
+
+		size_t count() const noexcept
+		{
+			return static_cast<size_t>(x1 - x0 + 1) * static_cast<size_t>(y1 - y0 + 1);
+		}
+	};
+
+	struct Entry
+	{
+		RectF rect{ 0, 0, 0, 0 };
+
+		CellRange cells;
+
+		// 描画順
+		uint32 order = 0;
+
+		// queryで重複を除くための印
+		uint32 stamp = 0;
+
+		// rebuildのorderに含まれていた
+		bool active = false;
+
+		bool registered = false;
+
+		bool oversized = false;
+	};
+
+	double m_cellSize;
+
+	Array<Entry> m_entries;
+
+	HashTable<uint64, Array<uint32>> m_cells;
+
+	// セルに載せていない大きな矩形のノード
+	Array<uint32> m_oversized;
+
+	size_t m_registered = 0;
+
+	uint32 m_stamp = 0;
+
+	// hitTestの前回の結果
+	Optional<Vec2> m_cachedPos;
+
+	uint32 m_cachedIndex = InvalidIndex;
+
+	Stats m_stats;
+
+	static uint64 CellKey(int32 x, int32 y) noexcept
+	{
+		return (static_cast<uint64>(static_cast<uint32>(x)) << 32) | static_cast<uint32>(y);
+	}
+
+	int32 cellCoord(double value) const noexcept
+	{
+		return static_cast<int32>(Math::Floor(value / m_cellSize));
+	}
+
+	CellRange cellRange(const RectF& rect) const noexcept;
+
+	void insert(uint32 index, const RectF& rect);
+
+	void remove(uint32 index);
+
+	// 手前から順に並べ替える
+	void sortByOrder(Array<uint32>& result, size_t begin) const;
+};
@@ -0,0 +1,107 @@
+﻿#include "LayoutHitIndex.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+
+namespace
+{
+	constexpr size_t NodeCount = 3'000;
+
+	constexpr size_t PointCount = 2'000;
+
+	constexpr SizeF Viewport{ 1280, 720 };
+
+	// 以前のWidgetTreeEditorと同じく、子を後ろから再帰で辿って一番手前のWidgetを探す
+	Widget* HitTestRecursive(Widget& widget, Vec2 pos)
+	{
+		auto layout = widget.layoutResults();
+
+		if (not layout)
+		{
+			return nullptr;
+		}
+
+		for (auto it = widget.children().rbegin(); it != widget.children().rend(); ++it)
+		{
+			if (auto found = HitTestRecursive(**it, pos))
+			{
+				return found;
+			}
+		}
+
+		return layout->rect().intersects(pos) ? &widget : nullptr;
+	}
+
+	// 画面外に並んだWidgetにも当たるよう、内容全体を覆う範囲
+	RectF ContentBounds(const Widget& widget)
+	{
+		RectF bounds{ Viewport };
+
+		if (auto layout = widget.layoutResults())
+		{
+			const RectF rect = layout->rect();
+			const Vec2 tl{ Min(bounds.x, rect.x), Min(bounds.y, rect.y) };
+			const Vec2 br{ Max(bounds.br().x, rect.br().x), Max(bounds.br().y, rect.br().y) };
+			bounds = RectF{ tl, (br - tl) };
+		}
+
+		for (auto& child : widget.children())
+		{
+			const RectF childBounds = ContentBounds(*child);
+			const Vec2 tl{ Min(bounds.x, childBounds.x), Min(bounds.y, childBounds.y) };
+			const Vec2 br{ Max(bounds.br().x, childBounds.br().x), Max(bounds.br().y, childBounds.br().y) };
+			bounds = RectF{ tl, (br - tl) };
+		}
+
+		return bounds;
+	}
+
+	void CompareWithRecursive(LayoutTree& tree, Widget& root, SmallRNG& rng, StringView step, Array<String>& failures)
+	{
+		const RectF bounds = ContentBounds(root);
+		size_t mismatches = 0;
+
+		for (size_t i = 0; i < PointCount; i++)
+		{
+			const Vec2 point = RandomVec2(bounds, rng);
+			Widget* expected = HitTestRecursive(root, point);
+
+			// 2回目は前回の結果を返す
+			mismatches += (tree.hitTest(point) != expected);
+			mismatches += (tree.hitTest(point) != expected);
+		}
+
+		if (mismatches)
+		{
+			failures << U"{}: indexed hit test differs from recursive hit test {} times"_fmt(step, mismatches);
+		}
+	}
+
+	const UnitTest::Registration LayoutHitIndexTest{ U"LayoutHitIndex", [](Array<String>& failures)
+		{
+			const auto root = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Cards, NodeCount);
+			LayoutTree tree{ root };
+			tree.calculateLayout(static_cast<float>(Viewport.x), static_cast<float>(Viewport.y));
+
+			SmallRNG rng{ 12345 };
+			CompareWithRecursive(tree, *root, rng, U"initial", failures);
+
+			// カードを入れ替え、折り返しの位置を変えてから索引を作り直させる
+			for (size_t i = 0; i < 8; i++)
+			{
+				const auto card = root->children()[Random(root->children().size() - 1, rng)];
+				root->moveChild(card, 0);
+			}
+			const auto removed = root->children().back();
+			root->removeChild(removed);
+			root->style().setPadding(facebook::yoga::Edge::Left, facebook::yoga::Style::Length::points(37));
+			root->markLayoutDirty();
+			tree.calculateLayout(static_cast<float>(Viewport.x), static_cast<float>(Viewport.y));
+
+			CompareWithRecursive(tree, *root, rng, U"after edit", failures);
+		} };
+}
+
+#endif
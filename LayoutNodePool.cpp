@@ -0,0 +1,183 @@
+﻿#include "LayoutNodePool.hpp"
+#include <yoga/node/Node.h>
+
+using namespace facebook;
+
+namespace
+{
+	struct alignas(yoga::Node) NodeStorage
+	{
+		std::byte bytes[sizeof(yoga::Node)];
+	};
+}
+
+struct LayoutNodePool::Slab
+{
+	std::unique_ptr<NodeStorage[]> storage;
+
+	size_t size;
+
+	Array<uint32> freeSlots;
+
+	Slab(size_t size)
+		: storage(new NodeStorage[size])
+		, size(size)
+	{
+		// 先頭から順に使われるよう逆順に積む
+		freeSlots.reserve(size);
+		for (size_t i = size; i > 0; i--)
+		{
+			freeSlots.push_back(static_cast<uint32>(i - 1));
+		}
+	}
+
+	const void* begin() const { return storage.get(); }
+
+	const void* end() const { return storage.get() + size; }
+
+	bool empty() const { return freeSlots.size() == size; }
+};
+
+LayoutNodePool::LayoutNodePool(size_t slabSize, size_t highWaterMark)
+	: m_slabSize(Max<size_t>(slabSize, 1))
+	, m_highWaterMark(highWaterMark) { }
+
+LayoutNodePool::~LayoutNodePool()
+{
+	assert(m_stats.live == 0);
+}
+
+yoga::Node* LayoutNodePool::acquire(const yoga::Config* config)
+{
+	std::lock_guard lock{ m_mutex };
+
+	Slab& slab = slabWithSpace();
+	uint32 slot = slab.freeSlots.back();
+	slab.freeSlots.pop_back();
+
+	void* memory = &slab.storage[slot];
+	yoga::Node* node = config == nullptr
+		? new (memory) yoga::Node()
+		: new (memory) yoga::Node(config);
+
+	m_stats.pooled--;
+	m_stats.live++;
+	m_stats.peak = Max(m_stats.peak, m_stats.live);
+
+	return node;
+}
+
+void LayoutNodePool::release(yoga::Node* node)
+{
+	std::lock_guard lock{ m_mutex };
+
+	size_t slabIndex = findSlab(node);
+	assert(slabIndex < m_slabs.size());
+
+	Slab* slab = m_slabs[slabIndex].get();
+	m_firstSlabWithSpace = Min(m_firstSlabWithSpace, slabIndex);
+
+	std::destroy_at(node);
+
+	auto slot = reinterpret_cast<NodeStorage*>(node) - slab->storage.get();
+	slab->freeSlots.push_back(static_cast<uint32>(slot));
+
+	m_stats.live--;
+	m_stats.pooled++;
+
+	// 上限を超えている間は空になったスラブをすぐに手放す
+	if (m_stats.pooled > m_highWaterMark && slab->empty())
+	{
+		m_slabs.erase(m_slabs.begin() + slabIndex);
+		m_stats.pooled -= m_slabSize;
+	}
+}
+
+size_t LayoutNodePool::trim(size_t maxNodes)
+{
+	std::lock_guard lock{ m_mutex };
+	return trimLocked(maxNodes);
+}
+
+size_t LayoutNodePool::highWaterMark() const
+{
+	std::lock_guard lock{ m_mutex };
+	return m_highWaterMark;
+}
+
+void LayoutNodePool::setHighWaterMark(size_t highWaterMark)
+{
+	std::lock_guard lock{ m_mutex };
+	m_highWaterMark = highWaterMark;
+
+	if (m_stats.pooled > m_highWaterMark)
+	{
+		trimLocked(m_stats.pooled - m_highWaterMark);
+	}
+}
+
+LayoutNodePool::Stats LayoutNodePool::stats() const
+{
+	std::lock_guard lock{ m_mutex };
+
+	Stats stats = m_stats;
+	stats.slabs = m_slabs.size();
+	stats.reservedBytes = m_slabs.size() * m_slabSize * sizeof(NodeStorage);
+	return stats;
+}
+
+size_t LayoutNodePool::findSlab(const void* pointer) const
+{
+	auto it = std::upper_bound(m_slabs.begin(), m_slabs.end(), pointer,
+		[](const void* p, const std::unique_ptr<Slab>& slab) { return std::less<>{}(p, slab->begin()); });
+
+	if (it == m_slabs.begin() ||
+		not std::less<>{}(pointer, (*std::prev(it))->end()))
+	{
+		return m_slabs.size();
+	}
+
+	return static_cast<size_t>(std::prev(it) - m_slabs.begin());
+}
+
+LayoutNodePool::Slab& LayoutNodePool::slabWithSpace()
+{
+	// アドレスの小さいスラブから詰めて局所性を保つ
+	for (; m_firstSlabWithSpace < m_slabs.size(); m_firstSlabWithSpace++)
+	{
+		if (not m_slabs[m_firstSlabWithSpace]->freeSlots.empty())
+		{
+			return *m_slabs[m_firstSlabWithSpace];
+		}
+	}
+
+	auto slab = std::make_unique<Slab>(m_slabSize);
+	auto it = std::upper_bound(m_slabs.begin(), m_slabs.end(), slab->begin(),
+		[](const void* p, const std::unique_ptr<Slab>& other) { return std::less<>{}(p, other->begin()); });
+
+	m_stats.pooled += m_slabSize;
+
+	// 他のスラブは全て埋まっているので、新しいスラブが空きのある先頭になる
+	it = m_slabs.insert(it, std::move(slab));
+	m_firstSlabWithSpace = static_cast<size_t>(it - m_slabs.begin());
+
+	return **it;
+}
+
+size_t LayoutNodePool::trimLocked(size_t maxNodes)
+{
+	size_t released = 0;
+
+	for (size_t i = m_slabs.size(); i > 0 && released + m_slabSize <= maxNodes; i--)
+	{
+		if (m_slabs[i - 1]->empty())
+		{
+			m_slabs.erase(m_slabs.begin() + (i - 1));
+			released += m_slabSize;
+		}
+	}
+
+	m_stats.pooled -= released;
+	m_firstSlabWithSpace = 0;
+	return released;
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+
+namespace facebook::yoga
+{
+	class Node;
+	class Config;
+}
+
+// yoga::Nodeをまとめて確保するスラブアロケータ
+// 複数のLayoutTreeで共有できる
+class LayoutNodePool
+{
+public:
+
+	struct Stats
+	{
+		// 使用中のノード数
+		size_t live = 0;
+
+		// 確保済みで未使用のノード数
+		size_t pooled = 0;
+
+		// liveの最大値
+		size_t peak = 0;
+
+		size_t slabs = 0;
+
+		size_t reservedBytes = 0;
+	};
+
+	static constexpr size_t DefaultSlabSize = 256;
+
+	static constexpr size_t DefaultHighWaterMark = 4096;
+
+	LayoutNodePool(size_t slabSize = DefaultSlabSize, size_t highWaterMark = DefaultHighWaterMark);
+
+	LayoutNodePool(const LayoutNodePool&) = delete;
+
+	LayoutNodePool& operator=(const LayoutNodePool&) = delete;
+
+public:
+
+	// configがnullptrの場合は既定のConfigを使う
+	facebook::yoga::Node* acquire(const facebook::yoga::Config* config);
+
+	// 親子関係を解除済みのノードを返却する
+	void release(facebook::yoga::Node* node);
+
+	// 空になったスラブを最大maxNodes個分解放し、解放したノード数を返す
+	size_t trim(size_t maxNodes = Largest<size_t>);
+
+	// 未使用ノードがこの数を超えたら空のスラブから解放する
+	size_t highWaterMark() const;
+
+	void setHighWaterMark(size_t highWaterMark);
+
+	Stats stats() const;
+
+	~LayoutNodePool();
+
+private:
+
+	struct Slab;
+
+	const size_t m_slabSize;
+
+	size_t m_highWaterMark;
+
+	// アドレス順に並べ、ノードの所属スラブを二分探索で引く
+	Array<std::unique_ptr<Slab>> m_slabs;
+
+	// これより前のスラブには空きがない
+	size_t m_firstSlabWithSpace = 0;
+
+	Stats m_stats;
+
+	mutable std::mutex m_mutex;
+
+	size_t findSlab(const void* pointer) const;
+
+	Slab& slabWithSpace();
+
+	size_t trimLocked(size_t maxNodes);
+};
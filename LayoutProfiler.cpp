@@ -0,0 +1,171 @@
+﻿#include "LayoutProfiler.hpp"
+#include "Widget.hpp"
+#include <yoga/node/Node.h>
+#include <yoga/config/Config.h>
+
+using namespace facebook;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// 開始と終了のイベントは同じスレッドから届く
+	thread_local Clock::time_point PassStart;
+
+	thread_local Clock::time_point MeasureStart;
+
+	double MicrosecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+	}
+}
+
+LayoutProfiler::LayoutProfiler()
+{
+	// yogaは購読を解除できないので、最初の1回だけ登録する
+	static std::once_flag once;
+	std::call_once(once, [] { yoga::Event::subscribe(&LayoutProfiler::Dispatch); });
+}
+
+void LayoutProfiler::reset()
+{
+	std::lock_guard lock{ m_mutex };
+
+	m_stats = { };
+	m_nodes.clear();
+	m_history.clear();
+	m_historyHead = 0;
+}
+
+LayoutProfiler::Stats LayoutProfiler::stats() const
+{
+	std::lock_guard lock{ m_mutex };
+	return m_stats;
+}
+
+Array<LayoutProfiler::NodeStats> LayoutProfiler::slowestNodes(size_t count) const
+{
+	Array<NodeStats> result;
+	{
+		std::lock_guard lock{ m_mutex };
+
+		result.reserve(m_nodes.size());
+		for (auto& [node, stats] : m_nodes)
+		{
+			if (stats.measureCalls == 0)
+			{
+				continue;
+			}
+
+			result.push_back(stats);
+			result.back().widget = Widget::GetInstance(*node);
+		}
+	}
+
+	count = Min(count, result.size());
+	std::partial_sort(result.begin(), result.begin() + count, result.end(),
+		[](const NodeStats& a, const NodeStats& b) { return a.measureMicroseconds > b.measureMicroseconds; });
+	result.resize(count);
+
+	return result;
+}
+
+Array<float> LayoutProfiler::passHistory() const
+{
+	std::lock_guard lock{ m_mutex };
+
+	Array<float> result;
+	result.reserve(m_history.size());
+	result.insert(result.end(), m_history.begin() + m_historyHead, m_history.end());
+	result.insert(result.end(), m_history.begin(), m_history.begin() + m_historyHead);
+	return result;
+}
+
+void LayoutProfiler::Dispatch(YGNodeConstRef node, yoga::Event::Type type, yoga::Event::Data data)
+{
+	const auto& yogaNode = *yoga::resolveRef(node);
+	auto profiler = static_cast<LayoutProfiler*>(yogaNode.getConfig()->getContext());
+
+	if (profiler && profiler->isEnabled())
+	{
+		profiler->onEvent(yogaNode, type, data);
+	}
+}
+
+void LayoutProfiler::onEvent(const yoga::Node& node, yoga::Event::Type type, yoga::Event::Data data)
+{
+	switch (type)
+	{
+	case yoga::Event::LayoutPassStart:
+		PassStart = Clock::now();
+		break;
+
+	case yoga::Event::LayoutPassEnd:
+	{
+		const double microseconds = MicrosecondsSince(PassStart);
+		const auto& layoutData = *data.get<yoga::Event::LayoutPassEnd>().layoutData;
+
+		std::lock_guard lock{ m_mutex };
+
+		m_stats.passes++;
+		m_stats.passMicroseconds += microseconds;
+		m_stats.lastPassMicroseconds = microseconds;
+		m_stats.maxPassMicroseconds = Max(m_stats.maxPassMicroseconds, microseconds);
+		m_stats.layouts += layoutData.layouts;
+		m_stats.measures += layoutData.measures;
+		m_stats.cachedLayouts += layoutData.cachedLayouts;
+		m_stats.cachedMeasures += layoutData.cachedMeasures;
+
+		if (m_history.size() < HistorySize)
+		{
+			m_history.push_back(static_cast<float>(microseconds));
+		}
+		else
+		{
+			m_history[m_historyHead] = static_cast<float>(microseconds);
+			m_historyHead = (m_historyHead + 1) % HistorySize;
+		}
+		break;
+	}
+
+	case yoga::Event::MeasureCallbackStart:
+		MeasureStart = Clock::now();
+		break;
+
+	case yoga::Event::MeasureCallbackEnd:
+	{
+		const double microseconds = MicrosecondsSince(MeasureStart);
+		const auto reason = static_cast<size_t>(data.get<yoga::Event::MeasureCallbackEnd>().reason);
+
+		std::lock_guard lock{ m_mutex };
+
+		m_stats.measureCallbacks++;
+		m_stats.measureMicroseconds += microseconds;
+		if (reason < ReasonCount)
+		{
+			m_stats.measureReasons[reason]++;
+		}
+
+		auto& stats = m_nodes[&node];
+		stats.measureCalls++;
+		stats.measureMicroseconds += microseconds;
+		stats.maxMeasureMicroseconds = Max(stats.maxMeasureMicroseconds, microseconds);
+		break;
+	}
+
+	case yoga::Event::NodeLayout:
+	{
+		const auto layoutType = data.get<yoga::Event::NodeLayout>().layoutType;
+		const bool cached = (layoutType == yoga::LayoutType::kCachedLayout || layoutType == yoga::LayoutType::kCachedMeasure);
+
+		std::lock_guard lock{ m_mutex };
+
+		auto& stats = m_nodes[&node];
+		(cached ? stats.cacheHits : stats.cacheMisses)++;
+		break;
+	}
+
+	default:
+		break;
+	}
+}
@@ -0,0 +1,119 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include <yoga/event/event.h>
+
+class Widget;
+namespace facebook::yoga { class Node; }
+
+// yogaのイベントを購読して、レイアウトの内訳を集計する
+// LayoutTree::setProfilerで渡したLayoutTreeのノードのイベントだけを数える
+// LayoutTreeより先に破棄する場合は、先にsetProfiler(nullptr)で外す
+// 並列や非同期のレイアウトでは複数のスレッドから記録される
+class LayoutProfiler
+{
+public:
+
+	static constexpr size_t ReasonCount = static_cast<size_t>(facebook::yoga::LayoutPassReason::COUNT);
+
+	// 集計の開始またはresetからの合計
+	struct Stats
+	{
+		// yogaのレイアウトパス (固定サイズの境界のレイアウトし直しを含む)
+		size_t passes = 0;
+
+		double passMicroseconds = 0;
+
+		double lastPassMicroseconds = 0;
+
+		double maxPassMicroseconds = 0;
+
+		// ノードごとのレイアウトと計測の回数。Cachedは保存された結果を使えたもの
+		size_t layouts = 0;
+
+		size_t measures = 0;
+
+		size_t cachedLayouts = 0;
+
+		size_t cachedMeasures = 0;
+
+		size_t measureCallbacks = 0;
+
+		double measureMicroseconds = 0;
+
+		// 計測関数が呼ばれた理由ごとの回数
+		std::array<size_t, ReasonCount> measureReasons{ };
+
+		size_t cacheHits() const noexcept { return cachedLayouts + cachedMeasures; }
+
+		size_t cacheMisses() const noexcept { return layouts + measures; }
+
+		double cacheHitRate() const noexcept
+		{
+			const size_t total = cacheHits() + cacheMisses();
+			return total ? static_cast<double>(cacheHits()) / total : 0;
+		}
+	};
+
+	// 1ノード分の集計
+	struct NodeStats
+	{
+		// 問い合わせた時点でノードに付いているWidget (破棄されていればnullptr)
+		const Widget* widget = nullptr;
+
+		size_t measureCalls = 0;
+
+		double measureMicroseconds = 0;
+
+		double maxMeasureMicroseconds = 0;
+
+		size_t cacheHits = 0;
+
+		size_t cacheMisses = 0;
+	};
+
+	// 直近のパスの時間を残す数
+	static constexpr size_t HistorySize = 120;
+
+	LayoutProfiler();
+
+	LayoutProfiler(const LayoutProfiler&) = delete;
+
+	LayoutProfiler& operator=(const LayoutProfiler&) = delete;
+
+public:
+
+	bool isEnabled() const noexcept { return m_enabled.load(std::memory_order_relaxed); }
+
+	// 無効の間はイベントを受け取っても数えない
+	void setEnabled(bool enabled) noexcept { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+	void reset();
+
+	Stats stats() const;
+
+	// 計測関数の合計時間が長い順。ノードは使い回されるので、ツリーを組み直したらresetする
+	Array<NodeStats> slowestNodes(size_t count) const;
+
+	// 古い順の直近のパスの時間 (マイクロ秒)
+	Array<float> passHistory() const;
+
+private:
+
+	std::atomic<bool> m_enabled{ true };
+
+	mutable std::mutex m_mutex;
+
+	Stats m_stats;
+
+	// widgetは問い合わせるときに埋める
+	HashTable<const facebook::yoga::Node*, NodeStats> m_nodes;
+
+	Array<float> m_history;
+
+	size_t m_historyHead = 0;
+
+	// yogaの購読者は全体で1つなので、ノードのConfigに付けたLayoutProfilerへ振り分ける
+	static void Dispatch(YGNodeConstRef node, facebook::yoga::Event::Type type, facebook::yoga::Event::Data data);
+
+	void onEvent(const facebook::yoga::Node& node, facebook::yoga::Event::Type type, facebook::yoga::Event::Data data);
+};
@@ -0,0 +1,134 @@
+﻿#include "LayoutProfilerPanel.hpp"
+#include <imgui.h>
+
+using namespace facebook;
+
+void LayoutProfilerPanel::update()
+{
+	if (not ImGui::Begin("Layout Profiler"))
+	{
+		ImGui::End();
+		return;
+	}
+
+	bool enabled = m_profiler.isEnabled();
+	if (ImGui::Checkbox("Enabled", &enabled))
+	{
+		m_profiler.setEnabled(enabled);
+	}
+
+	ImGui::SameLine();
+	if (ImGui::Button("Reset"))
+	{
+		m_profiler.reset();
+	}
+
+	// 直前のcalculateLayoutで何が起きたか
+	if (ImGui::CollapsingHeader("Frame", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		const auto& frame = m_tree.frameStats();
+
+		const char* result = frame.skipped ? "skipped (clean)"
+			: frame.cacheHit ? "cache hit"
+			: frame.inFlight ? "in flight (async)"
+			: frame.layoutRun ? "layout"
+			: "-";
+
+		ImGui::Text("Result: %s%s", result, frame.published ? ", published" : "");
+		ImGui::Text("Relayout roots: %zu", frame.relayoutRoots);
+		ImGui::Text("Nodes visited: %zu", frame.nodesVisited);
+		ImGui::Text("Measure calls: %zu", frame.measureCalls);
+	}
+
+	const auto stats = m_profiler.stats();
+
+	if (ImGui::CollapsingHeader("Layout Passes", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::Text("Passes: %zu", stats.passes);
+		ImGui::Text("Last: %.1f us, Max: %.1f us, Mean: %.1f us",
+			stats.lastPassMicroseconds, stats.maxPassMicroseconds,
+			stats.passes ? stats.passMicroseconds / stats.passes : 0.0);
+
+		const auto history = m_profiler.passHistory();
+		if (not history.empty())
+		{
+			ImGui::PlotLines("##history", history.data(), static_cast<int>(history.size()), 0, "pass time (us)", 0.0f, FLT_MAX, ImVec2{ -FLT_MIN, 60 });
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Cache", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::Text("Hit rate: %.1f%% (%zu hits, %zu misses)", stats.cacheHitRate() * 100, stats.cacheHits(), stats.cacheMisses());
+		ImGui::Text("Layouts: %zu (cached %zu)", stats.layouts, stats.cachedLayouts);
+		ImGui::Text("Measures: %zu (cached %zu)", stats.measures, stats.cachedMeasures);
+	}
+
+	if (ImGui::CollapsingHeader("Measure Callbacks", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::Text("Calls: %zu, Total: %.1f us", stats.measureCallbacks, stats.measureMicroseconds);
+
+		// 計測関数が呼ばれた理由
+		if (ImGui::BeginTable("reasons", 2, ImGuiTableFlags_Borders))
+		{
+			for (size_t i = 0; i < LayoutProfiler::ReasonCount; i++)
+			{
+				if (stats.measureReasons[i] == 0)
+				{
+					continue;
+				}
+
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+				ImGui::TextUnformatted(yoga::LayoutPassReasonToString(static_cast<yoga::LayoutPassReason>(i)));
+				ImGui::TableSetColumnIndex(1);
+				ImGui::Text("%zu", stats.measureReasons[i]);
+			}
+
+			ImGui::EndTable();
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Slowest Nodes", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		if (ImGui::BeginTable("nodes", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Widget");
+			ImGui::TableSetupColumn("Calls");
+			ImGui::TableSetupColumn("Total (us)");
+			ImGui::TableSetupColumn("Max (us)");
+			ImGui::TableSetupColumn("Hits");
+			ImGui::TableSetupColumn("Misses");
+			ImGui::TableHeadersRow();
+
+			for (auto& node : m_profiler.slowestNodes(slowestNodeCount))
+			{
+				ImGui::TableNextRow();
+
+				ImGui::TableSetColumnIndex(0);
+				if (node.widget)
+				{
+					ImGui::Text("%s %s", typeid(*node.widget).name(), node.widget->name().toUTF8().c_str());
+				}
+				else
+				{
+					ImGui::TextUnformatted("(released)");
+				}
+
+				ImGui::TableSetColumnIndex(1);
+				ImGui::Text("%zu", node.measureCalls);
+				ImGui::TableSetColumnIndex(2);
+				ImGui::Text("%.1f", node.measureMicroseconds);
+				ImGui::TableSetColumnIndex(3);
+				ImGui::Text("%.1f", node.maxMeasureMicroseconds);
+				ImGui::TableSetColumnIndex(4);
+				ImGui::Text("%zu", node.cacheHits);
+				ImGui::TableSetColumnIndex(5);
+				ImGui::Text("%zu", node.cacheMisses);
+			}
+
+			ImGui::EndTable();
+		}
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+#include "LayoutTree.hpp"
+#include "LayoutProfiler.hpp"
+
+// LayoutProfilerの集計とLayoutTreeのフレームごとの処理をImGuiのウィンドウに表示する
+class LayoutProfilerPanel
+{
+public:
+
+	LayoutProfilerPanel(const LayoutTree& tree, LayoutProfiler& profiler)
+		: m_tree(tree)
+		, m_profiler(profiler) { }
+
+public:
+
+	// 計測関数の時間が長いノードを表示する数
+	size_t slowestNodeCount = 10;
+
+	void update();
+
+private:
+
+	const LayoutTree& m_tree;
+
+	LayoutProfiler& m_profiler;
+};
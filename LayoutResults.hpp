@@ -10,6 +10,8 @@ struct Thickness
 	double right = 0;
 
 	double bottom = 0;
+
+	bool operator==(const Thickness&) const = default;
 };
 
 struct LayoutResults
@@ -24,6 +26,8 @@ struct LayoutResults
 
 	Thickness padding;
 
+	bool operator==(const LayoutResults&) const = default;
+
 	RectF rect() const noexcept
 	{
 		return localRect.movedBy(offset);
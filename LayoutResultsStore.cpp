@@ -0,0 +1,266 @@
+﻿#include "LayoutResultsStore.hpp"
+
+uint32 LayoutResultsStore::allocate()
+{
+	if (not m_freeIndices.empty())
+	{
+		uint32 index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+		m_state[index] = State::Allocated;
+		return index;
+	}
+
+	uint32 index = static_cast<uint32>(m_state.size());
+
+	m_state.push_back(State::Allocated);
+	m_offsetX.push_back(0);
+	m_offsetY.push_back(0);
+	m_x.push_back(0);
+	m_y.push_back(0);
+	m_width.push_back(0);
+	m_height.push_back(0);
+	m_boundsX.push_back(0);
+	m_boundsY.push_back(0);
+	m_boundsWidth.push_back(0);
+	m_boundsHeight.push_back(0);
+
+	for (size_t edge = 0; edge < 4; edge++)
+	{
+		m_margin[edge].push_back(0);
+		m_border[edge].push_back(0);
+		m_padding[edge].push_back(0);
+	}
+
+	return index;
+}
+
+void LayoutResultsStore::release(uint32 index)
+{
+	if (index >= m_state.size() || m_state[index] == State::Free)
+	{
+		return;
+	}
+
+	m_state[index] = State::Free;
+	m_freeIndices.push_back(index);
+
+	// 一括取得で空の矩形になるよう値を消しておく
+	setOffset(index, { 0, 0 });
+	setBox(index, { });
+	setBounds(index, RectF{ 0, 0, 0, 0 });
+}
+
+void LayoutResultsStore::clear()
+{
+	m_state.clear();
+	m_freeIndices.clear();
+	m_offsetX.clear();
+	m_offsetY.clear();
+	m_x.clear();
+	m_y.clear();
+	m_width.clear();
+	m_height.clear();
+	m_boundsX.clear();
+	m_boundsY.clear();
+	m_boundsWidth.clear();
+	m_boundsHeight.clear();
+
+	for (size_t edge = 0; edge < 4; edge++)
+	{
+		m_margin[edge].clear();
+		m_border[edge].clear();
+		m_padding[edge].clear();
+	}
+}
+
+void LayoutResultsStore::copyFrom(const LayoutResultsStore& source, const Array<uint32>& indices)
+{
+	const size_t count = source.capacity();
+
+	m_state.resize(count, State::Free);
+	m_offsetX.resize(count);
+	m_offsetY.resize(count);
+	m_x.resize(count);
+	m_y.resize(count);
+	m_width.resize(count);
+	m_height.resize(count);
+	m_boundsX.resize(count);
+	m_boundsY.resize(count);
+	m_boundsWidth.resize(count);
+	m_boundsHeight.resize(count);
+
+	for (size_t edge = 0; edge < 4; edge++)
+	{
+		m_margin[edge].resize(count);
+		m_border[edge].resize(count);
+		m_padding[edge].resize(count);
+	}
+
+	m_freeIndices = source.m_freeIndices;
+
+	for (auto index : indices)
+	{
+		m_state[index] = source.m_state[index];
+		m_offsetX[index] = source.m_offsetX[index];
+		m_offsetY[index] = source.m_offsetY[index];
+		m_x[index] = source.m_x[index];
+		m_y[index] = source.m_y[index];
+		m_width[index] = source.m_width[index];
+		m_height[index] = source.m_height[index];
+		m_boundsX[index] = source.m_boundsX[index];
+		m_boundsY[index] = source.m_boundsY[index];
+		m_boundsWidth[index] = source.m_boundsWidth[index];
+		m_boundsHeight[index] = source.m_boundsHeight[index];
+
+		for (size_t edge = 0; edge < 4; edge++)
+		{
+			m_margin[edge][index] = source.m_margin[edge][index];
+			m_border[edge][index] = source.m_border[edge][index];
+			m_padding[edge][index] = source.m_padding[edge][index];
+		}
+	}
+}
+
+void LayoutResultsStore::invalidateResults()
+{
+	for (auto& state : m_state)
+	{
+		if (state == State::HasResults)
+		{
+			state = State::Allocated;
+		}
+	}
+}
+
+void LayoutResultsStore::setBox(uint32 index, const Box& box) noexcept
+{
+	m_x[index] = box.x;
+	m_y[index] = box.y;
+	m_width[index] = box.width;
+	m_height[index] = box.height;
+
+	for (size_t edge = 0; edge < 4; edge++)
+	{
+		m_margin[edge][index] = box.margin[edge];
+		m_border[edge][index] = box.border[edge];
+		m_padding[edge][index] = box.padding[edge];
+	}
+
+	if (m_state[index] == State::Allocated)
+	{
+		m_state[index] = State::HasResults;
+	}
+}
+
+LayoutResults LayoutResultsStore::get(uint32 index) const
+{
+	return LayoutResults{
+		.offset = { m_offsetX[index], m_offsetY[index] },
+		.margin = {
+			m_margin[Left][index],
+			m_margin[Top][index],
+			m_margin[Right][index],
+			m_margin[Bottom][index],
+		},
+		.localRect = {
+			m_x[index],
+			m_y[index],
+			m_width[index],
+			m_height[index]
+		},
+		.border = {
+			m_border[Left][index],
+			m_border[Top][index],
+			m_border[Right][index],
+			m_border[Bottom][index],
+		},
+		.padding = {
+			m_padding[Left][index],
+			m_padding[Top][index],
+			m_padding[Right][index],
+			m_padding[Bottom][index],
+		}
+	};
+}
+
+// 以下の一括取得は分岐のない単純なループにして、コンパイラがベクトル化できるようにしている
+
+void LayoutResultsStore::rects(Array<RectF>& result) const
+{
+	const size_t count = capacity();
+	result.resize(count);
+
+	const float* offsetX = m_offsetX.data();
+	const float* offsetY = m_offsetY.data();
+	const float* x = m_x.data();
+	const float* y = m_y.data();
+	const float* width = m_width.data();
+	const float* height = m_height.data();
+	RectF* out = result.data();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i].x = offsetX[i] + x[i];
+		out[i].y = offsetY[i] + y[i];
+		out[i].w = width[i];
+		out[i].h = height[i];
+	}
+}
+
+void LayoutResultsStore::innerRects(Array<RectF>& result) const
+{
+	const size_t count = capacity();
+	result.resize(count);
+
+	const float* offsetX = m_offsetX.data();
+	const float* offsetY = m_offsetY.data();
+	const float* x = m_x.data();
+	const float* y = m_y.data();
+	const float* width = m_width.data();
+	const float* height = m_height.data();
+	const float* left = m_border[Left].data();
+	const float* top = m_border[Top].data();
+	const float* right = m_border[Right].data();
+	const float* bottom = m_border[Bottom].data();
+	const float* paddingLeft = m_padding[Left].data();
+	const float* paddingTop = m_padding[Top].data();
+	const float* paddingRight = m_padding[Right].data();
+	const float* paddingBottom = m_padding[Bottom].data();
+	RectF* out = result.data();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float insetLeft = left[i] + paddingLeft[i];
+		const float insetTop = top[i] + paddingTop[i];
+		out[i].x = offsetX[i] + x[i] + insetLeft;
+		out[i].y = offsetY[i] + y[i] + insetTop;
+		out[i].w = width[i] - insetLeft - right[i] - paddingRight[i];
+		out[i].h = height[i] - insetTop - bottom[i] - paddingBottom[i];
+	}
+}
+
+void LayoutResultsStore::outerRects(Array<RectF>& result) const
+{
+	const size_t count = capacity();
+	result.resize(count);
+
+	const float* offsetX = m_offsetX.data();
+	const float* offsetY = m_offsetY.data();
+	const float* x = m_x.data();
+	const float* y = m_y.data();
+	const float* width = m_width.data();
+	const float* height = m_height.data();
+	const float* left = m_margin[Left].data();
+	const float* top = m_margin[Top].data();
+	const float* right = m_margin[Right].data();
+	const float* bottom = m_margin[Bottom].data();
+	RectF* out = result.data();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i].x = offsetX[i] + x[i] - left[i];
+		out[i].y = offsetY[i] + y[i] - top[i];
+		out[i].w = width[i] + left[i] + right[i];
+		out[i].h = height[i] + top[i] + bottom[i];
+	}
+}
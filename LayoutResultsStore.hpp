@@ -0,0 +1,124 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "LayoutResults.hpp"
+
+// LayoutTree内の全ウィジェットのレイアウト結果を、ノード番号で引ける連続したfloat配列に保持する
+class LayoutResultsStore
+{
+public:
+
+	static constexpr uint32 InvalidIndex = Largest<uint32>;
+
+	// yogaのレイアウト結果1ノード分 (left, top, right, bottomの順)
+	struct Box
+	{
+		float x = 0;
+
+		float y = 0;
+
+		float width = 0;
+
+		float height = 0;
+
+		std::array<float, 4> margin{ };
+
+		std::array<float, 4> border{ };
+
+		std::array<float, 4> padding{ };
+	};
+
+public:
+
+	uint32 allocate();
+
+	void release(uint32 index);
+
+	void clear();
+
+	// 番号はそのままで全ノードを結果なしに戻し、次の更新で全て書き直させる
+	void invalidateResults();
+
+	// 番号の上限 (解放済みの番号を含む)
+	size_t capacity() const noexcept { return m_state.size(); }
+
+	size_t size() const noexcept { return m_state.size() - m_freeIndices.size(); }
+
+	bool hasResults(uint32 index) const noexcept
+	{
+		return index < m_state.size() && m_state[index] == State::HasResults;
+	}
+
+	Float2 offset(uint32 index) const noexcept { return{ m_offsetX[index], m_offsetY[index] }; }
+
+	void setOffset(uint32 index, Float2 offset) noexcept
+	{
+		m_offsetX[index] = offset.x;
+		m_offsetY[index] = offset.y;
+	}
+
+	Float2 localPos(uint32 index) const noexcept { return{ m_x[index], m_y[index] }; }
+
+	void setBox(uint32 index, const Box& box) noexcept;
+
+	LayoutResults get(uint32 index) const;
+
+	// get(index).rect()と同じ
+	RectF rect(uint32 index) const noexcept
+	{
+		return{ m_offsetX[index] + m_x[index], m_offsetY[index] + m_y[index], m_width[index], m_height[index] };
+	}
+
+	// 自身と子孫が描かれうる範囲。overflowがvisibleでないノードは自身の矩形まで
+	RectF bounds(uint32 index) const noexcept
+	{
+		return{ m_boundsX[index], m_boundsY[index], m_boundsWidth[index], m_boundsHeight[index] };
+	}
+
+	void setBounds(uint32 index, const RectF& bounds) noexcept
+	{
+		m_boundsX[index] = static_cast<float>(bounds.x);
+		m_boundsY[index] = static_cast<float>(bounds.y);
+		m_boundsWidth[index] = static_cast<float>(bounds.w);
+		m_boundsHeight[index] = static_cast<float>(bounds.h);
+	}
+
+	// sourceのうちindicesの番号の状態と結果だけを写す (重複してもよい)
+	// 番号の上限と空き番号はsourceに合わせるので、それ以外の番号はsourceと同じである必要がある
+	void copyFrom(const LayoutResultsStore& source, const Array<uint32>& indices);
+
+	// 全ノード分の矩形を番号順に書き出す。結果のないノードは空の矩形になる
+	void rects(Array<RectF>& result) const;
+
+	void innerRects(Array<RectF>& result) const;
+
+	void outerRects(Array<RectF>& result) const;
+
+private:
+
+	enum class State : uint8
+	{
+		Free,
+		Allocated,
+		HasResults,
+	};
+
+	enum Edge : size_t
+	{
+		Left,
+		Top,
+		Right,
+		Bottom,
+	};
+
+	Array<State> m_state;
+
+	Array<uint32> m_freeIndices;
+
+	Array<float> m_offsetX, m_offsetY;
+
+	Array<float> m_x, m_y, m_width, m_height;
+
+	Array<float> m_boundsX, m_boundsY, m_boundsWidth, m_boundsHeight;
+
+	std::array<Array<float>, 4> m_margin, m_border, m_padding;
+};
@@ -0,0 +1,113 @@
+﻿#include "LayoutResultsStore.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+#include "Label.hpp"
+
+namespace
+{
+	constexpr size_t NodeCount = 3'000;
+
+	constexpr size_t Iterations = 8;
+
+	constexpr SizeF Viewport{ 1280, 720 };
+
+	// 描かれうる範囲が、自身の矩形と切り抜かれない子の範囲を含んでいる数を数える
+	size_t CountBoundsViolations(const Widget& widget, const LayoutResultsStore& store)
+	{
+		const uint32 index = widget.layoutIndex();
+
+		if (not store.hasResults(index))
+		{
+			return 0;
+		}
+
+		// floatに丸めた誤差は許す
+		const RectF bounds = store.bounds(index).stretched(0.5);
+		const bool clips = (widget.style().overflow() != facebook::yoga::Overflow::Visible);
+		size_t violations = 0;
+
+		auto covers = [&](const RectF& rect)
+			{
+				return (rect.w <= 0) || (rect.h <= 0) || bounds.contains(rect);
+			};
+
+		if (not covers(store.rect(index)))
+		{
+			violations++;
+		}
+
+		for (auto& child : widget.children())
+		{
+			const uint32 childIndex = child->layoutIndex();
+
+			if (not clips && store.hasResults(childIndex) && not covers(store.bounds(childIndex)))
+			{
+				violations++;
+			}
+
+			violations += CountBoundsViolations(*child, store);
+		}
+
+		return violations;
+	}
+
+	void CollectLabels(Widget& widget, Array<Label*>& result)
+	{
+		if (auto label = dynamic_cast<Label*>(&widget))
+		{
+			result.push_back(label);
+		}
+
+		for (auto& child : widget.children())
+		{
+			CollectLabels(*child, result);
+		}
+	}
+
+	const UnitTest::Registration LayoutResultsStoreTest{ U"LayoutResultsStore bounds", [](Array<String>& failures)
+		{
+			const auto root = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Cards, NodeCount);
+
+			// 半分のカードは、はみ出した文字を切り抜く
+			for (auto [i, card] : Indexed(root->children()))
+			{
+				if (i % 2 == 0)
+				{
+					card->style().setOverflow(facebook::yoga::Overflow::Hidden);
+				}
+			}
+
+			Array<Label*> labels;
+			CollectLabels(*root, labels);
+
+			LayoutTree tree{ root };
+			tree.calculateLayout(static_cast<float>(Viewport.x), static_cast<float>(Viewport.y));
+
+			SmallRNG rng{ 12345 };
+
+			for (size_t i = 0; i < Iterations; i++)
+			{
+				if (const size_t violations = CountBoundsViolations(*root, tree.layoutResultsStore()))
+				{
+					failures << U"iteration {}: {} draw bounds did not cover their descendants"_fmt(i, violations);
+				}
+
+				// カードの中だけをレイアウトし直させ、祖先へ範囲を広げる経路を通す
+				{
+					LayoutTree::Batch batch{ tree };
+
+					for (size_t k = 0; k < Max<size_t>(labels.size() / 64, 1); k++)
+					{
+						const size_t index = Random(labels.size() - 1, rng);
+						labels[index]->setText(U"Edited {} {}"_fmt(i, String(static_cast<size_t>(Random(1, 80, rng)), U'#')));
+					}
+				}
+				tree.calculateLayout(static_cast<float>(Viewport.x), static_cast<float>(Viewport.y));
+			}
+		} };
+}
+
+#endif
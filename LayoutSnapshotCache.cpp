@@ -0,0 +1,70 @@
+﻿#include "LayoutSnapshotCache.hpp"
+
+const LayoutResultsStore* LayoutSnapshotCache::find(Float2 size, uint64 version)
+{
+	m_entries.remove_if([=](const Entry& entry) { return entry.version != version; });
+
+	for (auto& entry : m_entries)
+	{
+		if (entry.size == size)
+		{
+			entry.lastUsed = ++m_tick;
+			m_stats.hits++;
+			return &entry.results;
+		}
+	}
+
+	m_stats.misses++;
+	return nullptr;
+}
+
+void LayoutSnapshotCache::insert(Float2 size, uint64 version, const LayoutResultsStore& results)
+{
+	if (m_capacity == 0)
+	{
+		return;
+	}
+
+	for (auto& entry : m_entries)
+	{
+		if (entry.version == version && entry.size == size)
+		{
+			entry.lastUsed = ++m_tick;
+			entry.results = results;
+			return;
+		}
+	}
+
+	if (m_entries.size() < m_capacity)
+	{
+		m_entries.push_back({ size, version, ++m_tick, results });
+		return;
+	}
+
+	// 配列を使い回して確保を減らす
+	auto& oldest = *std::min_element(m_entries.begin(), m_entries.end(),
+		[](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+	oldest.size = size;
+	oldest.version = version;
+	oldest.lastUsed = ++m_tick;
+	oldest.results = results;
+}
+
+void LayoutSnapshotCache::clear()
+{
+	m_entries.clear();
+}
+
+void LayoutSnapshotCache::setCapacity(size_t capacity)
+{
+	m_capacity = capacity;
+
+	while (m_entries.size() > m_capacity)
+	{
+		auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+			[](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+		m_entries.erase(oldest);
+	}
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "LayoutResultsStore.hpp"
+
+// レイアウトの大きさとツリーの版ごとに、全ノードのレイアウト結果を保持するLRUキャッシュ
+class LayoutSnapshotCache
+{
+public:
+
+	struct Stats
+	{
+		size_t hits = 0;
+
+		size_t misses = 0;
+	};
+
+	static constexpr size_t DefaultCapacity = 4;
+
+	explicit LayoutSnapshotCache(size_t capacity = DefaultCapacity)
+		: m_capacity(capacity) { }
+
+public:
+
+	// 一致するものがなければnullptr。版の違うものは二度と使われないので捨てる
+	const LayoutResultsStore* find(Float2 size, uint64 version);
+
+	// 容量を超えた場合は最も長く使われていないものを捨てる
+	void insert(Float2 size, uint64 version, const LayoutResultsStore& results);
+
+	void clear();
+
+	size_t capacity() const noexcept { return m_capacity; }
+
+	// 0でキャッシュしない
+	void setCapacity(size_t capacity);
+
+	size_t size() const noexcept { return m_entries.size(); }
+
+	const Stats& stats() const noexcept { return m_stats; }
+
+	void resetStats() noexcept { m_stats = { }; }
+
+private:
+
+	struct Entry
+	{
+		Float2 size;
+
+		uint64 version;
+
+		uint64 lastUsed;
+
+		LayoutResultsStore results;
+	};
+
+	size_t m_capacity;
+
+	uint64 m_tick = 0;
+
+	Array<Entry> m_entries;
+
+	Stats m_stats;
+};
@@ -1,35 +1,417 @@
 ﻿#include "LayoutTree.hpp"
+#include "LayoutBoundary.hpp"
 #include <yoga/node/Node.h>
 #include <yoga/algorithm/CalculateLayout.h>
+#include <yoga/algorithm/PixelGrid.h>
 #include <yoga/enums/Direction.h>
+#include <yoga/config/Config.h>
+#include <yoga/YGConfig.h>
 
 using namespace facebook;
 
+namespace
+{
+	// 大きさのない矩形は何も描かれないので範囲に含めない
+	RectF MergeBounds(const RectF& a, const RectF& b)
+	{
+		if (b.w <= 0 || b.h <= 0)
+		{
+			return a;
+		}
+
+		if (a.w <= 0 || a.h <= 0)
+		{
+			return b;
+		}
+
+		const double left = Min(a.x, b.x);
+		const double top = Min(a.y, b.y);
+		const double right = Max(a.x + a.w, b.x + b.w);
+		const double bottom = Max(a.y + a.h, b.y + b.h);
+		return{ left, top, (right - left), (bottom - top) };
+	}
+
+	bool ClipsChildren(const yoga::Node& node)
+	{
+		return node.style().overflow() != yoga::Overflow::Visible;
+	}
+
+	struct ConfigDeleter
+	{
+		void operator()(yoga::Config* config) const
+		{
+			YGConfigFree(config);
+		}
+	};
+
+	// 1つずつ渡されたタスクを背景スレッドで実行する
+	class AsyncWorker
+	{
+	public:
+
+		void start(std::function<void()> task)
+		{
+			if (not m_thread.joinable())
+			{
+				m_thread = std::thread{ [this] { loop(); } };
+			}
+
+			{
+				std::lock_guard lock{ m_mutex };
+				m_task = std::move(task);
+				m_busy = true;
+			}
+			m_wake.notify_all();
+		}
+
+		bool busy() const noexcept
+		{
+			return m_busy.load(std::memory_order_acquire);
+		}
+
+		void wait()
+		{
+			std::unique_lock lock{ m_mutex };
+			m_done.wait(lock, [this] { return not m_busy; });
+		}
+
+		~AsyncWorker()
+		{
+			if (not m_thread.joinable())
+			{
+				return;
+			}
+
+			{
+				std::lock_guard lock{ m_mutex };
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			m_thread.join();
+		}
+
+	private:
+
+		std::thread m_thread;
+
+		std::mutex m_mutex;
+
+		std::condition_variable m_wake;
+
+		std::condition_variable m_done;
+
+		std::function<void()> m_task;
+
+		std::atomic<bool> m_busy = false;
+
+		bool m_stop = false;
+
+		void loop()
+		{
+			while (true)
+			{
+				std::function<void()> task;
+				{
+					std::unique_lock lock{ m_mutex };
+					m_wake.wait(lock, [this] { return m_stop || m_task; });
+
+					if (m_stop)
+					{
+						return;
+					}
+
+					task = std::move(m_task);
+					m_task = nullptr;
+				}
+
+				task();
+
+				{
+					std::lock_guard lock{ m_mutex };
+					m_busy = false;
+				}
+				m_done.notify_all();
+			}
+		}
+	};
+}
+
 class LayoutTree::Impl
 {
 public:
 
-	yoga::Config* config = nullptr;
+	Impl(LayoutTree& tree, std::shared_ptr<LayoutNodePool> pool)
+		: tree(tree)
+		, pool(pool ? std::move(pool) : std::make_shared<LayoutNodePool>()) { }
 
-	yoga::Node rootNode;
+	LayoutTree& tree;
 
-	std::vector<std::unique_ptr<yoga::Node>> unusedNodes;
+	// 別スレッドで同時にレイアウトできるようLayoutTreeごとに持つ
+	std::unique_ptr<yoga::Config, ConfigDeleter> config{ yoga::resolveRef(YGConfigNew()) };
 
-	yoga::Node* newNode()
+	yoga::Node rootNode{ config.get() };
+
+	std::shared_ptr<LayoutNodePool> pool;
+
+	std::shared_ptr<WidgetPool> widgetPool = std::make_shared<WidgetPool>();
+
+	LayoutResultsStore store;
+
+	struct NameBucket
+	{
+		Array<Widget*> widgets;
+
+		// widgetsをツリーの順に並べたときのstructureVersion
+		uint64 sortedVersion = Largest<uint64>;
+	};
+
+	// 名前ごとの、このツリーに属するWidget。空の名前は載せない
+	HashTable<WidgetName::Pointer, NameBucket> names;
+
+	uint64 structureVersion = 0;
+
+	// Widgetのm_treeOrderを振ったときのstructureVersion
+	uint64 treeOrderVersion = Largest<uint64>;
+
+	SelectorCache selectors;
+
+	// 公開済みの結果の矩形の索引
+	LayoutHitIndex hitIndex;
+
+	// hitIndexの番号ごとのWidget
+	Array<Widget*> hitWidgets;
+
+	// hitIndexを作ったときのstructureVersion (Largestで作り直す)
+	// 作ったときの公開済みの結果の容量はhitWidgetsの大きさで分かる
+	uint64 hitStructureVersion = Largest<uint64>;
+
+	Array<uint32> hitOrder;
+
+	Array<uint32> hitIndices;
+
+	// レイアウト結果の更新で位置か大きさが変わった番号 (非同期の場合は背景スレッドが書く)
+	Array<uint32> movedRects;
+
+	// 公開済みで、hitIndexへまだ反映していない番号
+	Array<uint32> pendingHitRects;
+
+	// 前回のconstruct以降に子の構成が変わったWidget
+	Array<std::weak_ptr<Widget>> changedWidgets;
+
+	// 追跡できない変更があり、全体を辿り直す必要がある
+	bool requiresFullConstruct = true;
+
+	// 全体を辿るconstructで、ノードの付け替えや作り直しがあった
+	bool structureModified = false;
+
+	LayoutWorkerPool* parallelPool = nullptr;
+
+	// 子孫の変更を吸収し、親へ汚れを伝えなかった境界
+	HashSet<yoga::Node*> relayoutRoots;
+
+	// 今回のレイアウトで親を辿らずに計算した境界。上からの走査では届かない
+	Array<yoga::Node*> relayoutBoundaries;
+
+	size_t relayoutCount = 0;
+
+	Array<yoga::Node*> pendingBoundaries;
+
+	uint64 version = 0;
+
+	LayoutSnapshotCache snapshots;
+
+	// storeに入っている結果の大きさと版
+	Float2 storeSize{ -1, -1 };
+
+	uint64 storeVersion = Largest<uint64>;
+
+	// storeをキャッシュから戻したため、yoga::Nodeの状態と一致していない
+	bool storeFromSnapshot = false;
+
+	FrameStats frameStats;
+
+	// 並列にレイアウトする場合は複数のスレッドから数えられる
+	std::atomic<size_t> measureCalls = 0;
+
+	// レイアウト結果の更新で辿ったノードの数
+	size_t visitCount = 0;
+
+	// 非同期にレイアウトする場合、WidgetのスタイルはWidget側が正となり、yoga::Nodeへは入れ替え時に反映する
+	bool async = false;
+
+	AsyncWorker worker;
+
+	// workerの結果をまだ公開していない
+	bool resultPending = false;
+
+	// 非同期の場合に描画に使う、前回公開した結果
+	LayoutResultsStore published;
+
+	// 非同期の場合に、レイアウト以外で解放されてpublishedへまだ写していない番号
+	Array<uint32> unpublishedIndices;
+
+	// レイアウト中に行われ、公開時に反映する変更
+	std::shared_ptr<Widget> pendingRoot;
+
+	// バッチの終了時またはレイアウトの公開時に汚すWidget (Widget::m_dirtyQueuedで重複を除く)
+	Array<std::weak_ptr<Widget>> pendingDirty;
+
+	size_t batchDepth = 0;
+
+	// レイアウト中に取り外されたWidgetを、yoga::Nodeから参照されなくなるまで生かしておく
+	Array<std::shared_ptr<Widget>> retainedWidgets;
+
+	bool inFlight() const noexcept
+	{
+		return worker.busy();
+	}
+
+	// Widgetのスタイルや計測用の状態をyoga::Nodeへ反映して汚す
+	void applyDirty(Widget& widget)
+	{
+		widget.m_dirtyQueued = false;
+
+		if (async)
+		{
+			widget.m_node->setStyle(*widget.m_style);
+		}
+
+		widget.onLayoutSnapshot();
+		markDirty(*widget.m_node, false);
+	}
+
+	// Widget::queryAllが辿るのと同じ順 (子が先、自身が後) に、全Widgetへ番号を振る
+	// 自身と子孫の番号はm_subtreeOrderからm_treeOrderまでに収まる
+	void updateTreeOrder()
+	{
+		if (treeOrderVersion == structureVersion)
+		{
+			return;
+		}
+
+		treeOrderVersion = structureVersion;
+
+		if (not tree.m_root)
+		{
+			return;
+		}
+
+		uint32 order = 0;
+
+		// 深い鎖でも溢れないよう積んで辿り、子を全て辿り終えて2度目に取り出したときに自身の番号を振る
+		Array<std::pair<Widget*, bool>> stack{ { tree.m_root.get(), false } };
+
+		while (not stack.empty())
+		{
+			const auto [widget, childrenVisited] = stack.back();
+			stack.pop_back();
+
+			if (childrenVisited)
+			{
+				widget->m_treeOrder = order++;
+				continue;
+			}
+
+			widget->m_subtreeOrder = order;
+			stack.emplace_back(widget, true);
+
+			for (auto it = widget->children().rbegin(); it != widget->children().rend(); ++it)
+			{
+				stack.emplace_back(it->get(), false);
+			}
+		}
+	}
+
+	void invalidateHitIndex()
+	{
+		hitStructureVersion = Largest<uint64>;
+		pendingHitRects.clear();
+	}
+
+	// 動いた矩形を、次の当たり判定で索引へ反映するよう溜める
+	void commitMovedRects()
+	{
+		pendingHitRects.append(movedRects);
+		movedRects.clear();
+
+		// 全体が動いた場合は作り直す方が速い
+		if (hitWidgets.size() < pendingHitRects.size())
+		{
+			invalidateHitIndex();
+		}
+	}
+
+	// 背景のレイアウトの結果を公開し、その間に溜まった変更を反映する
+	void publish()
+	{
+		// 全体を複製せず、このレイアウトで書き換えた番号と解放した番号だけを写す
+		unpublishedIndices.append(movedRects);
+		published.copyFrom(store, unpublishedIndices);
+		unpublishedIndices.clear();
+
+		resultPending = false;
+		commitMovedRects();
+
+		frameStats.relayoutRoots = relayoutCount;
+		frameStats.nodesVisited = visitCount;
+		frameStats.measureCalls = measureCalls;
+
+		if (pendingRoot)
+		{
+			tree.construct(std::move(pendingRoot));
+			pendingRoot = nullptr;
+		}
+
+		if (batchDepth == 0)
+		{
+			flushPendingDirty();
+		}
+
+		// 取り外したWidgetのノードは上のconstructで解放されたので、ここで手放してよい
+		retainedWidgets.clear();
+	}
+
+	// 溜めておいたWidgetを汚す
+	// 祖先へは既に汚れたノードで伝えるのをやめるので、共通の経路は一度だけ辿られる
+	void flushPendingDirty()
 	{
-		if (unusedNodes.empty())
+		for (auto& weak : pendingDirty)
 		{
-			return config == nullptr
-				? new yoga::Node()
-				: new yoga::Node(config);
+			auto widget = weak.lock();
+			if (not widget)
+			{
+				continue;
+			}
+
+			if (widget->m_tree == &tree)
+			{
+				applyDirty(*widget);
+			}
+			else
+			{
+				widget->m_dirtyQueued = false;
+			}
 		}
+		pendingDirty.clear();
+	}
 
-		yoga::Node* cachedNode = unusedNodes.back().release();
-		unusedNodes.pop_back();
+	template <class Fn>
+	static void ForEachWidget(yoga::Node& node, Fn&& fn)
+	{
+		if (auto widget = Widget::GetInstance(node))
+		{
+			fn(node, *widget);
+		}
 
-		cachedNode->reset();
+		for (auto child : node.getChildren())
+		{
+			ForEachWidget(*child, fn);
+		}
+	}
 
-		return cachedNode;
+	yoga::Node* newNode()
+	{
+		return pool->acquire(config.get());
 	}
 
 	void releaseNode(yoga::Node* node)
@@ -39,18 +421,26 @@ public:
 			releaseNode(child);
 		}
 
+		// 他のノードへ付け替え済みでなければWidgetとの紐づけを解除
+		if (auto widget = Widget::GetInstance(*node);
+			widget && widget->m_node == node)
+		{
+			detachWidget(*widget);
+		}
+
+		relayoutRoots.erase(node);
+		structureModified = true;
+
 		node->setOwner(nullptr);
 		node->clearChildren();
 		node->setContext(nullptr);
 
-		unusedNodes.emplace_back(std::unique_ptr<yoga::Node>(node));
+		pool->release(node);
 	}
 
 	void construct(yoga::Node& node, Widget& widget)
 	{
-		assert(widget.children.empty() || widget.allowChildren());
-
-		auto& children = node.getChildren();
+		assert(widget.children().empty() || widget.allowChildren());
 
 		// IDが違うときはOwnerだけ残してリセット
 		if (node.getContext() == nullptr ||
@@ -63,144 +453,1124 @@ public:
 			{
 				releaseNode(childNode);
 			}
+
+			if (auto oldWidget = Widget::GetInstance(node);
+				oldWidget && oldWidget->m_node == &node)
+			{
+				detachWidget(*oldWidget);
+			}
+
 			node.setOwner(nullptr);
 			node.clearChildren();
 			node.reset();
 
 			node.setOwner(owner);
 			node.setContext(&widget);
+			structureModified = true;
 		}
 
-		// 子要素がないとき全解放
-		if (widget.children.empty())
+		reconcileChildren(node, widget);
+
+		// 子の更新
+		auto& children = node.getChildren();
+		for (auto [i, childWidget] : Indexed(widget.children()))
 		{
-			for (auto childNode : children)
-			{
-				releaseNode(childNode);
-			}
-			node.clearChildren();
-			node.markDirtyAndPropagate();
+			childWidget->m_parent = &widget;
+			construct(*children[i], *childWidget);
+		}
 
-			// yoga::NodeとWidgetを紐づけ
-			widget.attachNode(node);
-			return;
+		// yoga::NodeとWidgetを紐づけ
+		if (widget.m_node != &node || widget.m_tree != &tree)
+		{
+			structureModified = true;
+		}
+
+		widget.attachNode(node);
+		widget.m_tree = &tree;
+
+		if (widget.m_nameIndex != &tree)
+		{
+			tree.indexName(widget);
 		}
 
-		// 多すぎる場合は解放
-		for (int32 i = children.size() - 1; i >= static_cast<int32>(widget.children.size()); i--)
+		if (widget.m_layoutIndex == LayoutResultsStore::InvalidIndex)
 		{
-			node.removeChild(i);
+			widget.m_layoutIndex = store.allocate();
+			structureModified = true;
 		}
+		widget.m_childrenChanged = false;
+	}
 
-		// 子ノードの追加
-		for (auto [i, childWidget] : Indexed(widget.children))
+	// 記録された変更のあったWidgetの子だけを組み直す
+	void constructChanged()
+	{
+		for (auto& weak : changedWidgets)
 		{
-			if (i < children.size())
+			auto widget = weak.lock();
+
+			// 削除済み、または親ごと組み直されたもの
+			if (not widget || widget->m_tree != &tree || not widget->m_childrenChanged)
 			{
-				auto child = children[i];
-				child->setOwner(&node);
+				continue;
 			}
-			else
-			{
-				// 足りない場合はノード作成
-				auto newChild = newNode();
-				newChild->setOwner(&node);
-				newChild->setContext(childWidget.get());
 
-				// 末尾に追加
-				node.insertChild(newChild, i);
+			auto& node = *widget->m_node;
+			reconcileChildren(node, *widget);
 
-				// 更新を伝える
-				node.markDirtyAndPropagate();
+			// 新しく作られたノードの部分木だけを構築
+			auto& children = node.getChildren();
+			for (auto [i, childWidget] : Indexed(widget->children()))
+			{
+				if (childWidget->m_node != children[i])
+				{
+					childWidget->m_parent = widget.get();
+					construct(*children[i], *childWidget);
+				}
 			}
+
+			widget->m_childrenChanged = false;
 		}
 
-		// 子の更新
-		for (auto [i, childWidget] : Indexed(widget.children))
+		changedWidgets.clear();
+	}
+
+	void clearChanges()
+	{
+		for (auto& weak : changedWidgets)
 		{
-			construct(*children[i], *childWidget);
+			if (auto widget = weak.lock())
+			{
+				widget->m_childrenChanged = false;
+			}
 		}
 
-		// yoga::NodeとWidgetを紐づけ
-		widget.attachNode(node);
+		changedWidgets.clear();
+		requiresFullConstruct = false;
 	}
 
-};
+	// 子ノードをWidget::id()で突き合わせ、既存のノードはレイアウトのキャッシュごと移動する
+	void reconcileChildren(yoga::Node& node, Widget& widget)
+	{
+		const auto& oldChildren = node.getChildren();
+		const size_t oldCount = oldChildren.size();
+		const size_t newCount = widget.children().size();
 
-LayoutTree::LayoutTree()
-	: m_impl(new Impl()) { }
+		// 先頭から一致する範囲
+		size_t head = 0;
+		auto headIt = widget.children().begin();
+		while (head < oldCount && head < newCount && IsNodeOf(*oldChildren[head], **headIt))
+		{
+			head++;
+			++headIt;
+		}
 
-LayoutTree::LayoutTree(std::shared_ptr<Widget> root)
-	: m_impl(new Impl())
-{
-	construct(root);
-}
+		if (head == oldCount && head == newCount)
+		{
+			return;
+		}
 
-LayoutTree::~LayoutTree() { }
+		structureModified = true;
 
-void LayoutTree::construct(std::shared_ptr<Widget> root)
-{
-	m_root = root;
-	m_impl->construct(m_impl->rootNode, *m_root);
-}
+		// 末尾から一致する範囲
+		size_t tail = 0;
+		auto tailIt = widget.children().rbegin();
+		while (tail < oldCount - head && tail < newCount - head && IsNodeOf(*oldChildren[oldCount - 1 - tail], **tailIt))
+		{
+			tail++;
+			++tailIt;
+		}
 
-void LayoutTree::cleanCache()
-{
-	m_impl->unusedNodes.clear();
-}
+		// 間に残った既存ノードをIDで引けるようにする
+		HashTable<int64, yoga::Node*> reusableNodes;
+		for (size_t i = head; i < oldCount - tail; i++)
+		{
+			auto childNode = oldChildren[i];
 
-void LayoutTree::calculateLayout(float width, float height)
-{
-	yoga::calculateLayout(
-		&(m_impl->rootNode),
-		width,
-		height,
-		yoga::Direction::Inherit
-	);
+			if (auto childWidget = Widget::GetInstance(*childNode))
+			{
+				reusableNodes.emplace(childWidget->id(), childNode);
+			}
+			else
+			{
+				releaseNode(childNode);
+			}
+		}
 
-	updateLayoutResults({ 0, 0 }, *m_root);
-}
+		std::vector<yoga::Node*> newChildren;
+		newChildren.reserve(newCount);
+		newChildren.insert(newChildren.end(), oldChildren.begin(), oldChildren.begin() + head);
 
-void LayoutTree::updateLayoutResults(Vec2 offset, Widget& widget)
+		auto it = headIt;
+		for (size_t i = head; i < newCount - tail; i++, ++it)
+		{
+			Widget& childWidget = **it;
+			yoga::Node* childNode;
+
+			if (auto found = reusableNodes.find(childWidget.id());
+				found != reusableNodes.end())
+			{
+				childNode = found->second;
+				reusableNodes.erase(found);
+			}
+			else
+			{
+				// 足りない場合はノード作成
+				childNode = newNode();
+				childNode->setContext(&childWidget);
+			}
+
+			childNode->setOwner(&node);
+			newChildren.push_back(childNode);
+		}
+
+		newChildren.insert(newChildren.end(), oldChildren.end() - tail, oldChildren.end());
+
+		// 使われなかったノードを解放
+		for (auto& [id, childNode] : reusableNodes)
+		{
+			releaseNode(childNode);
+		}
+
+		node.setChildren(newChildren);
+
+		// 子が変わっても大きさが固定されたノードの外には影響しない
+		markDirty(node, true);
+	}
+
+	// 親へ汚れを伝え、大きさが固定されたノードで止めてそこからレイアウトし直す
+	// selfAbsorbsがfalseの場合はnode自身のスタイルが変わった可能性があるので、node自身では止めない
+	void markDirty(yoga::Node& node, bool selfAbsorbs)
+	{
+		version++;
+
+		for (yoga::Node* current = &node; current; current = current->getOwner())
+		{
+			// 既に汚れていれば、そこから上は伝わっている
+			if (current->isDirty())
+			{
+				return;
+			}
+
+			current->setDirty(true);
+			current->setLayoutComputedFlexBasis(yoga::FloatOptional{});
+
+			if ((current != &node || selfAbsorbs) && LayoutBoundary::CanRelayout(*current))
+			{
+				relayoutRoots.insert(current);
+				return;
+			}
+		}
+	}
+
+	// 汚れたレイアウト境界を先にレイアウトし、続くルートからのレイアウトではキャッシュとして使わせる
+	void calculateBoundaries()
+	{
+		relayoutBoundaries.clear();
+
+		for (auto node : relayoutRoots)
+		{
+			// 親が汚れていれば上からのレイアウトで辿られる
+			if (node->isDirty() && not node->getOwner()->isDirty())
+			{
+				relayoutBoundaries.push_back(node);
+			}
+		}
+
+		// 他の境界の中にあるものは外側より先に順に計算し、残りは互いに重ならないので並列に計算できる
+		pendingBoundaries.clear();
+		for (auto node : relayoutBoundaries)
+		{
+			if (hasRelayoutAncestor(*node))
+			{
+				LayoutBoundary::Calculate(*node);
+			}
+			else
+			{
+				pendingBoundaries.push_back(node);
+			}
+		}
+		relayoutRoots.clear();
+		relayoutCount = relayoutBoundaries.size();
+
+		calculateDisjoint(pendingBoundaries);
+
+		if (parallelPool)
+		{
+			// ルートから汚れた経路で見つかる境界は、上で計算した境界の祖先でありうるので後から計算する
+			pendingBoundaries.clear();
+			LayoutBoundary::CollectDirty(rootNode, pendingBoundaries);
+			calculateDisjoint(pendingBoundaries);
+		}
+	}
+
+	// 互いに重ならない境界を計算する
+	void calculateDisjoint(const Array<yoga::Node*>& nodes)
+	{
+		if (parallelPool && nodes.size() >= 2)
+		{
+			parallelPool->run(nodes.size(), [&](size_t i)
+				{
+					LayoutBoundary::Calculate(*nodes[i]);
+				});
+			return;
+		}
+
+		for (auto node : nodes)
+		{
+			LayoutBoundary::Calculate(*node);
+		}
+	}
+
+	bool hasRelayoutAncestor(const yoga::Node& node) const
+	{
+		for (auto owner = node.getOwner(); owner; owner = owner->getOwner())
+		{
+			if (relayoutRoots.contains(owner))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// 上からのレイアウトが境界まで届かなかった場合はピクセル境界への丸めも行われないので、ここで丸める
+	// 丸め済みの値を丸め直しても変わらない
+	void roundRelayoutRoots()
+	{
+		for (auto node : relayoutBoundaries)
+		{
+			auto widget = Widget::GetInstance(*node);
+
+			if (widget && store.hasResults(widget->m_layoutIndex))
+			{
+				const Float2 offset = store.offset(widget->m_layoutIndex);
+				yoga::roundLayoutResultsToPixelGrid(node, offset.x, offset.y);
+			}
+		}
+	}
+
+	static bool IsNodeOf(const yoga::Node& node, const Widget& widget)
+	{
+		auto nodeWidget = Widget::GetInstance(node);
+		return nodeWidget && nodeWidget->id() == widget.id();
+	}
+
+	~Impl()
+	{
+		worker.wait();
+
+		for (auto childNode : rootNode.getChildren())
+		{
+			releaseNode(childNode);
+		}
+		rootNode.clearChildren();
+
+		if (auto widget = Widget::GetInstance(rootNode);
+			widget && widget->m_node == &rootNode)
+		{
+			detachWidget(*widget);
+		}
+	}
+
+	void releaseIndex(uint32 index)
+	{
+		if (index == LayoutResultsStore::InvalidIndex)
+		{
+			return;
+		}
+
+		store.release(index);
+
+		if (async)
+		{
+			unpublishedIndices.push_back(index);
+		}
+	}
+
+	void detachWidget(Widget& widget)
+	{
+		if (widget.m_nameIndex == &tree)
+		{
+			tree.unindexName(widget);
+		}
+
+		releaseIndex(widget.m_layoutIndex);
+		widget.m_layoutIndex = LayoutResultsStore::InvalidIndex;
+		widget.detachNode();
+	}
+};
+
+LayoutTree::LayoutTree(std::shared_ptr<LayoutNodePool> pool)
+	: m_impl(new Impl(*this, std::move(pool))) { }
+
+LayoutTree::LayoutTree(std::shared_ptr<Widget> root, std::shared_ptr<LayoutNodePool> pool)
+	: m_impl(new Impl(*this, std::move(pool)))
 {
-	auto& node = *widget.m_node;
-	auto& layout = node.getLayout();
+	construct(root);
+}
+
+LayoutTree::~LayoutTree()
+{
+	// m_rootはm_implより先に破棄されるので、背景のレイアウトが計測中のWidgetを消さないよう先に待つ
+	m_impl->worker.wait();
 
-	if (not widget.m_layoutResults.has_value() || node.getHasNewLayout())
+	// constructしていないWidgetも載っているので、ノードからではなくWidgetから辿って外す
+	if (m_root)
 	{
-		widget.m_layoutResults = LayoutResults{
+		unindexNames(*m_root);
+	}
+}
+
+void LayoutTree::construct(std::shared_ptr<Widget> root)
+{
+	// レイアウト中はyoga::Nodeを触れないので公開時に行う
+	if (m_impl->inFlight())
+	{
+		m_impl->pendingRoot = std::move(root);
+		return;
+	}
+
+	// 子の構成はWidgetのappendChildなどでしか変わらず、全て記録されるので、記録があればその部分だけを組み直す
+	// 記録がない場合や根が替わった場合は全体を辿る
+	if (root == m_root &&
+		not m_impl->requiresFullConstruct &&
+		not m_impl->changedWidgets.empty())
+	{
+		m_impl->constructChanged();
+		return;
+	}
+
+	if (m_root && m_root != root)
+	{
+		unindexNames(*m_root);
+	}
+
+	// 何も変わっていなければ版は進めず、キャッシュや索引をそのまま使わせる
+	m_impl->structureModified = (m_root != root);
+	m_root = root;
+	m_impl->construct(m_impl->rootNode, *m_root);
+	m_impl->clearChanges();
+
+	if (m_impl->structureModified)
+	{
+		m_impl->structureVersion++;
+		m_impl->version++;
+	}
+}
+
+const std::shared_ptr<LayoutNodePool>& LayoutTree::nodePool() const
+{
+	return m_impl->pool;
+}
+
+const std::shared_ptr<WidgetPool>& LayoutTree::widgetPool() const
+{
+	return m_impl->widgetPool;
+}
+
+const LayoutResultsStore& LayoutTree::layoutResultsStore() const
+{
+	return m_impl->async ? m_impl->published : m_impl->store;
+}
+
+const Array<Widget*>& LayoutTree::namedWidgets(WidgetName::Pointer name)
+{
+	static const Array<Widget*> empty;
+
+	auto& impl = *m_impl;
+
+	auto it = impl.names.find(name);
+	if (it == impl.names.end())
+	{
+		return empty;
+	}
+
+	// 索引への追加や削除で崩れた並びを、構成が変わった後に引かれたときだけ直す
+	auto& bucket = it->second;
+	if (bucket.sortedVersion != impl.structureVersion)
+	{
+		impl.updateTreeOrder();
+
+		std::sort(bucket.widgets.begin(), bucket.widgets.end(),
+			[](const Widget* a, const Widget* b) { return a->m_treeOrder < b->m_treeOrder; });
+
+		for (auto [i, widget] : Indexed(bucket.widgets))
+		{
+			widget->m_nameSlot = static_cast<uint32>(i);
+		}
+
+		bucket.sortedVersion = impl.structureVersion;
+	}
+
+	return bucket.widgets;
+}
+
+std::span<Widget* const> LayoutTree::namedWidgets(WidgetName::Pointer name, const Widget& scope)
+{
+	assert(scope.m_nameIndex == this);
+
+	// 並べ直した後はscopeの番号も今の構成のもの
+	const auto& widgets = namedWidgets(name);
+
+	const auto first = std::lower_bound(widgets.begin(), widgets.end(), scope.m_subtreeOrder,
+		[](const Widget* widget, uint32 order) { return widget->m_treeOrder < order; });
+	const auto last = std::upper_bound(first, widgets.end(), scope.m_treeOrder,
+		[](uint32 order, const Widget* widget) { return order < widget->m_treeOrder; });
+
+	return{ first, last };
+}
+
+Widget* LayoutTree::find(int64 id) const
+{
+	auto widget = WidgetSlotMap::Find(id);
+	return (widget && widget->m_nameIndex == this) ? widget : nullptr;
+}
+
+const Array<Widget*>* LayoutTree::select(StringView selector, Widget* scope)
+{
+	if (not scope)
+	{
+		scope = m_root.get();
+	}
+
+	if (not scope)
+	{
+		static const Array<Widget*> empty;
+		return &empty;
+	}
+
+	assert(scope->m_nameIndex == this);
+	return m_impl->selectors.select(*scope, selector, m_impl->structureVersion);
+}
+
+uint64 LayoutTree::structureVersion() const
+{
+	return m_impl->structureVersion;
+}
+
+const SelectorCache::Stats& LayoutTree::selectorCacheStats() const
+{
+	return m_impl->selectors.stats();
+}
+
+Widget* LayoutTree::hitTest(Vec2 pos)
+{
+	updateHitIndex();
+
+	const uint32 index = m_impl->hitIndex.hitTest(pos);
+	return (index == LayoutHitIndex::InvalidIndex) ? nullptr : m_impl->hitWidgets[index];
+}
+
+void LayoutTree::hitTestAll(Vec2 pos, Array<Widget*>& result)
+{
+	updateHitIndex();
+
+	auto& indices = m_impl->hitIndices;
+	indices.clear();
+	m_impl->hitIndex.hitTestAll(pos, indices);
+
+	for (auto index : indices)
+	{
+		result.push_back(m_impl->hitWidgets[index]);
+	}
+}
+
+void LayoutTree::queryRect(const RectF& rect, Array<Widget*>& result)
+{
+	updateHitIndex();
+
+	auto& indices = m_impl->hitIndices;
+	indices.clear();
+	m_impl->hitIndex.query(rect, indices);
+
+	for (auto index : indices)
+	{
+		result.push_back(m_impl->hitWidgets[index]);
+	}
+}
+
+const LayoutHitIndex::Stats& LayoutTree::hitIndexStats() const
+{
+	return m_impl->hitIndex.stats();
+}
+
+void LayoutTree::updateHitIndex()
+{
+	auto& impl = *m_impl;
+	const auto& store = layoutResultsStore();
+
+	// 非同期の場合、公開済みの結果は裏の結果より番号が少ないことがあるので、公開時に広がれば作り直す
+	if (impl.hitStructureVersion == impl.structureVersion && impl.hitWidgets.size() == store.capacity())
+	{
+		if (not impl.pendingHitRects.empty())
+		{
+			impl.hitIndex.update(store, impl.pendingHitRects);
+			impl.pendingHitRects.clear();
+		}
+		return;
+	}
+
+	// 描画と同じ順 (親、子の順) に並べる
+	impl.hitWidgets.assign(store.capacity(), nullptr);
+	impl.hitOrder.clear();
+
+	if (m_root)
+	{
+		Array<Widget*> stack{ m_root.get() };
+
+		while (not stack.empty())
+		{
+			Widget* widget = stack.back();
+			stack.pop_back();
+
+			if (widget->m_tree == this && widget->m_layoutIndex < impl.hitWidgets.size())
+			{
+				impl.hitWidgets[widget->m_layoutIndex] = widget;
+				impl.hitOrder.push_back(widget->m_layoutIndex);
+			}
+
+			for (auto it = widget->children().rbegin(); it != widget->children().rend(); ++it)
+			{
+				stack.push_back(it->get());
+			}
+		}
+	}
+
+	impl.hitIndex.rebuild(store, impl.hitOrder);
+	impl.hitStructureVersion = impl.structureVersion;
+	impl.pendingHitRects.clear();
+}
+
+void LayoutTree::recordStructureChange()
+{
+	m_impl->structureVersion++;
+}
+
+void LayoutTree::indexName(Widget& widget)
+{
+	if (widget.m_nameIndex)
+	{
+		widget.m_nameIndex->unindexName(widget);
+	}
+
+	widget.m_nameIndex = this;
+	m_impl->structureVersion++;
+
+	if (widget.m_name == WidgetName::Empty())
+	{
+		return;
+	}
+
+	auto& bucket = m_impl->names[widget.m_name.get()].widgets;
+	widget.m_nameSlot = static_cast<uint32>(bucket.size());
+	bucket.push_back(&widget);
+}
+
+void LayoutTree::unindexName(Widget& widget)
+{
+	assert(widget.m_nameIndex == this);
+	widget.m_nameIndex = nullptr;
+	m_impl->structureVersion++;
+
+	if (widget.m_name == WidgetName::Empty())
+	{
+		return;
+	}
+
+	auto it = m_impl->names.find(widget.m_name.get());
+	assert(it != m_impl->names.end());
+
+	// 末尾のWidgetを空いた位置へ移す (並びはnamedWidgetsで直す)
+	auto& bucket = it->second.widgets;
+	Widget* last = bucket.back();
+	bucket[widget.m_nameSlot] = last;
+	last->m_nameSlot = widget.m_nameSlot;
+	bucket.pop_back();
+
+	if (bucket.empty())
+	{
+		m_impl->names.erase(it);
+	}
+}
+
+void LayoutTree::indexNames(Widget& root)
+{
+	if (root.m_nameIndex != this)
+	{
+		indexName(root);
+	}
+
+	for (auto& child : root.children())
+	{
+		indexNames(*child);
+	}
+}
+
+void LayoutTree::unindexNames(Widget& root)
+{
+	if (root.m_nameIndex == this)
+	{
+		unindexName(root);
+	}
+
+	for (auto& child : root.children())
+	{
+		unindexNames(*child);
+	}
+}
+
+void LayoutTree::rename(Widget& widget, WidgetName::Reference name)
+{
+	unindexName(widget);
+	widget.m_name = std::move(name);
+	indexName(widget);
+}
+
+void LayoutTree::recordChange(Widget& widget)
+{
+	if (widget.m_childrenChanged)
+	{
+		return;
+	}
+
+	widget.m_childrenChanged = true;
+
+	auto weak = widget.weak_from_this();
+	if (weak.expired())
+	{
+		// shared_ptrで管理されていないWidgetは追跡できない
+		m_impl->requiresFullConstruct = true;
+		return;
+	}
+
+	m_impl->changedWidgets.push_back(std::move(weak));
+}
+
+void LayoutTree::cleanCache()
+{
+	m_impl->pool->trim();
+	m_impl->widgetPool->trim();
+}
+
+void LayoutTree::calculateLayout(float width, float height)
+{
+	if (m_impl->async)
+	{
+		calculateLayoutAsync(width, height);
+		return;
+	}
+
+	auto& impl = *m_impl;
+	impl.frameStats = { };
+
+	// yoga::Nodeが直接汚された場合
+	if (impl.rootNode.isDirty())
+	{
+		impl.version++;
+	}
+
+	const Float2 size{ width, height };
+
+	// 前回と同じ大きさで何も変わっていなければ、yogaも結果の更新も不要
+	if (impl.storeSize == size && impl.storeVersion == impl.version)
+	{
+		impl.frameStats.skipped = true;
+		return;
+	}
+
+	if (auto snapshot = impl.snapshots.find(size, impl.version))
+	{
+		impl.store = *snapshot;
+		impl.invalidateHitIndex();
+		impl.storeSize = size;
+		impl.storeVersion = impl.version;
+		impl.storeFromSnapshot = true;
+		impl.frameStats.cacheHit = true;
+		return;
+	}
+
+	// yogaが辿らなかったノードの結果も書き直させる
+	if (impl.storeFromSnapshot)
+	{
+		impl.store.invalidateResults();
+		impl.storeFromSnapshot = false;
+	}
+
+	impl.measureCalls = 0;
+	impl.visitCount = 0;
+	impl.frameStats.layoutRun = true;
+
+	calculateNodeLayout(width, height);
+
+	updateLayoutResults();
+	impl.commitMovedRects();
+
+	impl.frameStats.relayoutRoots = impl.relayoutCount;
+	impl.frameStats.nodesVisited = impl.visitCount;
+	impl.frameStats.measureCalls = impl.measureCalls;
+
+	impl.snapshots.insert(size, impl.version, impl.store);
+	impl.storeSize = size;
+	impl.storeVersion = impl.version;
+}
+
+void LayoutTree::calculateLayoutAsync(float width, float height)
+{
+	auto& impl = *m_impl;
+	impl.frameStats = { };
+
+	// 前回のレイアウトが終わるまでは公開済みの結果を使い続ける
+	if (impl.inFlight())
+	{
+		impl.frameStats.inFlight = true;
+		return;
+	}
+
+	if (impl.resultPending)
+	{
+		impl.publish();
+		impl.frameStats.published = true;
+	}
+
+	if (impl.rootNode.isDirty())
+	{
+		impl.version++;
+	}
+
+	const Float2 size{ width, height };
+
+	if (impl.storeSize == size && impl.storeVersion == impl.version)
+	{
+		impl.frameStats.skipped = not impl.frameStats.published;
+		return;
+	}
+
+	impl.storeSize = size;
+	impl.storeVersion = impl.version;
+	impl.measureCalls = 0;
+	impl.visitCount = 0;
+	impl.resultPending = true;
+	impl.frameStats.layoutRun = true;
+
+	impl.worker.start([this, width, height]
+		{
+			calculateNodeLayout(width, height);
+			updateLayoutResults();
+		});
+}
+
+void LayoutTree::setAsyncLayout(bool enabled)
+{
+	auto& impl = *m_impl;
+
+	if (impl.async == enabled)
+	{
+		return;
+	}
+
+	waitForLayout();
+
+	// スタイルの正をyoga::NodeとWidgetの間で移す
+	Impl::ForEachWidget(impl.rootNode, [&](yoga::Node& node, Widget& widget)
+		{
+			if (enabled)
+			{
+				widget.pullNodeStyle();
+			}
+			else
+			{
+				node.setStyle(*widget.m_style);
+			}
+		});
+
+	impl.published = impl.store;
+	impl.unpublishedIndices.clear();
+	impl.invalidateHitIndex();
+	impl.async = enabled;
+}
+
+bool LayoutTree::isAsyncLayout() const
+{
+	return m_impl->async;
+}
+
+bool LayoutTree::isLayoutInFlight() const
+{
+	return m_impl->inFlight();
+}
+
+void LayoutTree::waitForLayout()
+{
+	auto& impl = *m_impl;
+
+	impl.worker.wait();
+
+	if (impl.resultPending)
+	{
+		impl.publish();
+	}
+}
+
+void LayoutTree::CalculateLayouts(const Array<LayoutRequest>& requests, LayoutWorkerPool& pool)
+{
+	pool.run(requests.size(), [&](size_t i)
+		{
+			auto& request = requests[i];
+			request.tree->calculateLayout(static_cast<float>(request.size.x), static_cast<float>(request.size.y));
+		});
+}
+
+void LayoutTree::setParallelLayout(LayoutWorkerPool* pool)
+{
+	m_impl->parallelPool = pool;
+}
+
+LayoutWorkerPool* LayoutTree::parallelLayout() const
+{
+	return m_impl->parallelPool;
+}
+
+void LayoutTree::setProfiler(LayoutProfiler* profiler)
+{
+	// 背景スレッドのレイアウト中にConfigを書き換えない
+	m_impl->worker.wait();
+
+	// yogaのイベントはノードしか渡さないので、ノードが共有するConfigから辿る
+	m_impl->config->setContext(profiler);
+}
+
+LayoutProfiler* LayoutTree::profiler() const
+{
+	return static_cast<LayoutProfiler*>(m_impl->config->getContext());
+}
+
+void LayoutTree::setLayoutCacheCapacity(size_t capacity)
+{
+	m_impl->snapshots.setCapacity(capacity);
+}
+
+const LayoutSnapshotCache::Stats& LayoutTree::layoutCacheStats() const
+{
+	return m_impl->snapshots.stats();
+}
+
+uint64 LayoutTree::version() const
+{
+	return m_impl->version;
+}
+
+const LayoutTree::FrameStats& LayoutTree::frameStats() const
+{
+	return m_impl->frameStats;
+}
+
+void LayoutTree::recordMeasure()
+{
+	m_impl->measureCalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LayoutTree::markDirty(Widget& widget)
+{
+	auto& impl = *m_impl;
+
+	if (impl.batchDepth > 0 || impl.inFlight())
+	{
+		if (widget.m_dirtyQueued)
+		{
+			return;
+		}
+
+		if (auto weak = widget.weak_from_this();
+			not weak.expired())
+		{
+			widget.m_dirtyQueued = true;
+			impl.pendingDirty.push_back(std::move(weak));
+			return;
+		}
+
+		// 追跡できないWidgetはすぐに反映する。レイアウト中であれば終了を待つ
+		if (impl.inFlight())
+		{
+			waitForLayout();
+		}
+	}
+
+	impl.applyDirty(widget);
+}
+
+void LayoutTree::beginBatch()
+{
+	m_impl->batchDepth++;
+}
+
+void LayoutTree::endBatch()
+{
+	auto& impl = *m_impl;
+
+	assert(impl.batchDepth > 0);
+
+	if (--impl.batchDepth > 0 || impl.inFlight())
+	{
+		return;
+	}
+
+	impl.flushPendingDirty();
+}
+
+void LayoutTree::waitForWorker()
+{
+	m_impl->worker.wait();
+}
+
+void LayoutTree::releaseLayoutIndex(Widget& widget)
+{
+	assert(not m_impl->inFlight());
+
+	m_impl->releaseIndex(std::exchange(widget.m_layoutIndex, LayoutResultsStore::InvalidIndex));
+}
+
+void LayoutTree::retainWhileLayout(std::shared_ptr<Widget> widget)
+{
+	if (m_impl->inFlight())
+	{
+		m_impl->retainedWidgets.push_back(std::move(widget));
+	}
+}
+
+void LayoutTree::calculateNodeLayout(float width, float height)
+{
+	m_impl->calculateBoundaries();
+
+	yoga::calculateLayout(
+		&(m_impl->rootNode),
+		width,
+		height,
+		yoga::Direction::Inherit
+	);
+
+	m_impl->roundRelayoutRoots();
+}
+
+void LayoutTree::updateLayoutResults()
+{
+	auto& store = m_impl->store;
+
+	// 親を辿らずにレイアウトし直した部分木は、上からの走査では届かないので直接更新する
+	for (auto node : m_impl->relayoutBoundaries)
+	{
+		auto widget = Widget::GetInstance(*node);
+
+		if (widget && store.hasResults(widget->m_layoutIndex))
+		{
+			const RectF bounds = updateLayoutResults(store.offset(widget->m_layoutIndex), *node);
+			growAncestorBounds(*node, bounds);
+		}
+	}
+	m_impl->relayoutBoundaries.clear();
+
+	updateLayoutResults({ 0, 0 }, m_impl->rootNode);
+}
+
+// 非同期の場合は背景スレッドで呼ばれるので、Widget::childrenではなくyoga::Nodeを辿る
+RectF LayoutTree::updateLayoutResults(Float2 offset, yoga::Node& node)
+{
+	auto& store = m_impl->store;
+
+	// Widgetが破棄されたノード。次のconstructで解放される
+	const auto widget = Widget::GetInstance(node);
+	if (not widget)
+	{
+		return RectF{ 0, 0, 0, 0 };
+	}
+
+	const uint32 index = widget->m_layoutIndex;
+
+	m_impl->visitCount++;
+
+	if (not store.hasResults(index) || node.getHasNewLayout())
+	{
+		// yogaが再計算したノードは子の位置も変わりうるので子を全て辿る
+		node.setHasNewLayout(false);
+
+		auto& layout = node.getLayout();
+		store.setBox(index, {
+			.x = layout.position(yoga::Edge::Left),
+			.y = layout.position(yoga::Edge::Top),
+			.width = layout.dimension(yoga::Dimension::Width),
+			.height = layout.dimension(yoga::Dimension::Height),
 			.margin = {
-				layout.margin(facebook::yoga::Edge::Left),
-				layout.margin(facebook::yoga::Edge::Top),
-				layout.margin(facebook::yoga::Edge::Right),
-				layout.margin(facebook::yoga::Edge::Bottom),
-			},
-			.localRect = {
-				layout.position(facebook::yoga::Edge::Left),
-				layout.position(facebook::yoga::Edge::Top),
-				layout.dimension(facebook::yoga::Dimension::Width),
-				layout.dimension(facebook::yoga::Dimension::Height)
+				layout.margin(yoga::Edge::Left),
+				layout.margin(yoga::Edge::Top),
+				layout.margin(yoga::Edge::Right),
+				layout.margin(yoga::Edge::Bottom),
 			},
 			.border = {
-				layout.border(facebook::yoga::Edge::Left),
-				layout.border(facebook::yoga::Edge::Top),
-				layout.border(facebook::yoga::Edge::Right),
-				layout.border(facebook::yoga::Edge::Bottom),
+				layout.border(yoga::Edge::Left),
+				layout.border(yoga::Edge::Top),
+				layout.border(yoga::Edge::Right),
+				layout.border(yoga::Edge::Bottom),
 			},
 			.padding = {
-				layout.padding(facebook::yoga::Edge::Left),
-				layout.padding(facebook::yoga::Edge::Top),
-				layout.padding(facebook::yoga::Edge::Right),
-				layout.padding(facebook::yoga::Edge::Bottom),
+				layout.padding(yoga::Edge::Left),
+				layout.padding(yoga::Edge::Top),
+				layout.padding(yoga::Edge::Right),
+				layout.padding(yoga::Edge::Bottom),
 			}
-		};
+		});
+	}
+	else if (store.offset(index) == offset)
+	{
+		// 自身のレイアウトも親からの位置も変わっていなければ子孫も変わらない
+		return store.bounds(index);
 	}
 
-	widget.m_layoutResults->offset = offset;
+	store.setOffset(index, offset);
+	m_impl->movedRects.push_back(index);
 
-	offset += widget.m_layoutResults->localRect.pos;
-	for (auto& child : widget.children)
+	// 子が切り抜かれるノードは自身の矩形の外に何も描かない
+	RectF bounds = store.rect(index);
+	const bool clips = ClipsChildren(node);
+
+	offset += store.localPos(index);
+	for (auto child : node.getChildren())
 	{
-		updateLayoutResults(offset, *child);
+		const RectF childBounds = updateLayoutResults(offset, *child);
+
+		if (not clips)
+		{
+			bounds = MergeBounds(bounds, childBounds);
+		}
+	}
+
+	store.setBounds(index, bounds);
+	return bounds;
+}
+
+void LayoutTree::growAncestorBounds(yoga::Node& node, RectF bounds)
+{
+	auto& store = m_impl->store;
+
+	for (auto owner = node.getOwner(); owner && not ClipsChildren(*owner); owner = owner->getOwner())
+	{
+		auto widget = Widget::GetInstance(*owner);
+		if (not widget || not store.hasResults(widget->m_layoutIndex))
+		{
+			return;
+		}
+
+		const RectF ownerBounds = store.bounds(widget->m_layoutIndex);
+		bounds = MergeBounds(ownerBounds, bounds);
+
+		// 既に含まれていれば、その先の祖先にも含まれている
+		if (bounds == ownerBounds)
+		{
+			return;
+		}
+
+		store.setBounds(widget->m_layoutIndex, bounds);
+
+		// 非同期の場合に公開する番号に含める
+		m_impl->movedRects.push_back(widget->m_layoutIndex);
 	}
 }
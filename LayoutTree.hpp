@@ -1,5 +1,13 @@
 ﻿#pragma once 
+#include <span>
 #include "Widget.hpp"
+#include "LayoutNodePool.hpp"
+#include "WidgetPool.hpp"
+#include "LayoutWorkerPool.hpp"
+#include "LayoutSnapshotCache.hpp"
+#include "LayoutProfiler.hpp"
+#include "SelectorCache.hpp"
+#include "LayoutHitIndex.hpp"
 
 class LayoutTree
 {
@@ -7,25 +15,216 @@ public:
 
 	class Impl;
 
-	LayoutTree();
+	// 直前のcalculateLayoutで行った処理
+	struct FrameStats
+	{
+		// 大きさも版も変わっておらず何もしなかった
+		bool skipped = false;
 
-	LayoutTree(std::shared_ptr<Widget> root);
+		// 保存した結果を使った
+		bool cacheHit = false;
+
+		// yogaでレイアウトした
+		bool layoutRun = false;
+
+		// 親を辿らずにレイアウトし直した境界の数
+		size_t relayoutRoots = 0;
+
+		// レイアウト結果の更新で辿ったノードの数
+		size_t nodesVisited = 0;
+
+		// 計測関数の呼び出し回数
+		size_t measureCalls = 0;
+
+		// 非同期: 前回のレイアウトがまだ終わっていない
+		bool inFlight = false;
+
+		// 非同期: 終わったレイアウトの結果を公開した (各数はそのレイアウトのもの)
+		bool published = false;
+	};
+
+	// 範囲内のmarkLayoutDirtyを溜め、抜けるときに重複を除いてまとめて汚す
+	class Batch
+	{
+	public:
+
+		explicit Batch(LayoutTree& tree)
+			: m_tree(tree)
+		{
+			m_tree.beginBatch();
+		}
+
+		Batch(const Batch&) = delete;
+
+		Batch& operator=(const Batch&) = delete;
+
+		~Batch()
+		{
+			m_tree.endBatch();
+		}
+
+	private:
+
+		LayoutTree& m_tree;
+	};
+
+	struct LayoutRequest
+	{
+		LayoutTree* tree;
+
+		SizeF size;
+	};
+
+	// poolを省略した場合はこのLayoutTree専用のプールを作る
+	LayoutTree(std::shared_ptr<LayoutNodePool> pool = nullptr);
+
+	LayoutTree(std::shared_ptr<Widget> root, std::shared_ptr<LayoutNodePool> pool = nullptr);
 
 	void construct(std::shared_ptr<Widget> root);
 
+	// 未使用のノードやWidgetを保持しているスラブを解放する
 	void cleanCache();
 
+	const std::shared_ptr<LayoutNodePool>& nodePool() const;
+
+	// このツリーのWidgetを作るためのプール
+	const std::shared_ptr<WidgetPool>& widgetPool() const;
+
 	void calculateLayout(Size size) { calculateLayout(size.x, size.y); }
 
 	void calculateLayout(float width, float height);
 
+	// 独立した複数のLayoutTreeを並列にレイアウトする
+	// 各LayoutTreeは別々のWidgetを根に持ち、互いに部分木を共有してはならない
+	static void CalculateLayouts(const Array<LayoutRequest>& requests, LayoutWorkerPool& pool = LayoutWorkerPool::Default());
+
+	// 大きさが固定された汚れた部分木を、poolで並列に先にレイアウトする (nullptrで無効)
+	// 結果は並列にしない場合と一致するが、計測関数は複数のスレッドから呼ばれる
+	void setParallelLayout(LayoutWorkerPool* pool);
+
+	LayoutWorkerPool* parallelLayout() const;
+
+	// このLayoutTreeのyogaのイベントをprofilerで集計する (nullptrで外す)
+	void setProfiler(LayoutProfiler* profiler);
+
+	LayoutProfiler* profiler() const;
+
+	// 同じ大きさ、同じ版のツリーを再びレイアウトする場合は保存した結果を使う (0で無効)
+	void setLayoutCacheCapacity(size_t capacity);
+
+	const LayoutSnapshotCache::Stats& layoutCacheStats() const;
+
+	// レイアウトに影響する変更があるたびに増える
+	uint64 version() const;
+
+	const FrameStats& frameStats() const;
+
+	// 非同期の場合、calculateLayoutはレイアウトを背景スレッドで始めてすぐに戻り、
+	// Widget::layoutResultsは終わった最新のレイアウトの結果を返す
+	// レイアウト中のconstruct、markLayoutDirty、removeChildは結果の公開時に反映される
+	// 非同期の場合はスタイルを変更したらmarkLayoutDirtyを呼ぶ必要がある。保存した結果のキャッシュは使われない
+	void setAsyncLayout(bool enabled);
+
+	bool isAsyncLayout() const;
+
+	bool isLayoutInFlight() const;
+
+	// 実行中のレイアウトを待ち、結果を公開する
+	void waitForLayout();
+
+	// 入れ子にでき、一番外側のendBatchで溜めた変更を反映する
+	void beginBatch();
+
+	void endBatch();
+
+	// 非同期の場合は公開済みの結果
+	const LayoutResultsStore& layoutResultsStore() const;
+
+	// ツリーに属するWidgetのうち、名前がnameのもの
+	// Widget::queryAllが辿るのと同じ順 (子が先、親が後) に並ぶ。構成が変わった後の最初の呼び出しでツリーを辿って並べ直す
+	// 子として追加したWidgetはconstructの前から、取り除いたWidgetはすぐに反映される
+	const Array<Widget*>& namedWidgets(WidgetName::Pointer name);
+
+	// namedWidgetsのうち、scopeとその子孫のもの。並びの中で連続しているので二分探索で切り出す
+	std::span<Widget* const> namedWidgets(WidgetName::Pointer name, const Widget& scope);
+
+	// idのWidgetがこのツリーに属していれば返す。破棄済みのWidgetのidはnullptr
+	Widget* find(int64 id) const;
+
+	// scopeとその子孫からセレクタに一致するWidget (scopeを省略した場合は根から)
+	// 結果はセレクタとscopeごとに保持され、structureVersionが変わるまではツリーを辿らずに返す
+	// 解析できないセレクタはnullptr。結果は次にselectを呼ぶまで有効
+	const Array<Widget*>* select(StringView selector, Widget* scope = nullptr);
+
+	// 子の構成か名前が変わるたびに増える
+	uint64 structureVersion() const;
+
+	const SelectorCache::Stats& selectorCacheStats() const;
+
+	// posを含むWidgetのうち一番手前 (描画順で後) のもの。なければnullptr
+	// 索引は構成が変わったら作り直し、レイアウトで動いたWidgetだけを載せ直す
+	// 前回と同じposで、その後に矩形が変わっていなければ前回の結果を返す
+	Widget* hitTest(Vec2 pos);
+
+	// posを含むWidgetを手前から順にresultの末尾に追加する
+	void hitTestAll(Vec2 pos, Array<Widget*>& result);
+
+	// rectと重なるWidgetを手前から順にresultの末尾に追加する
+	void queryRect(const RectF& rect, Array<Widget*>& result);
+
+	const LayoutHitIndex::Stats& hitIndexStats() const;
+
 private:
 
+	friend Widget;
+
+	friend class LayoutBenchmark;
+
 	std::unique_ptr<Impl> m_impl;
 
 	std::shared_ptr<Widget> m_root;
 
-	void updateLayoutResults(Vec2 offset, Widget& widget);
+	void recordChange(Widget& widget);
+
+	void markDirty(Widget& widget);
+
+	void recordMeasure();
+
+	void retainWhileLayout(std::shared_ptr<Widget> widget);
+
+	// 背景のレイアウトの終了を待つ。結果の公開はしない
+	void waitForWorker();
+
+	// ノードと紐づいたまま破棄されるWidgetの結果の番号を解放する (レイアウト中には呼ばない)
+	void releaseLayoutIndex(Widget& widget);
+
+	void indexName(Widget& widget);
+
+	void unindexName(Widget& widget);
+
+	// rootから下の全Widgetを索引に載せる、または外す
+	void indexNames(Widget& root);
+
+	void unindexNames(Widget& root);
+
+	void rename(Widget& widget, WidgetName::Reference name);
+
+	void recordStructureChange();
+
+	// 当たり判定の索引を公開済みの結果に合わせる
+	void updateHitIndex();
+
+	void calculateLayoutAsync(float width, float height);
+
+	void calculateNodeLayout(float width, float height);
+
+	void updateLayoutResults();
+
+	// nodeと子孫の結果を更新し、nodeが描かれうる範囲を返す
+	RectF updateLayoutResults(Float2 offset, facebook::yoga::Node& node);
+
+	// 親を辿らずに更新した部分木がはみ出した分だけ、祖先の描かれうる範囲を広げる
+	void growAncestorBounds(facebook::yoga::Node& node, RectF bounds);
 
 public:
 
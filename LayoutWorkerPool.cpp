@@ -0,0 +1,154 @@
+﻿#include "LayoutWorkerPool.hpp"
+
+namespace
+{
+	// 現在のスレッドがタスクを実行中のプール
+	thread_local const LayoutWorkerPool* CurrentPool = nullptr;
+}
+
+LayoutWorkerPool::LayoutWorkerPool(size_t threadCount)
+	: m_queueCount(Max<size_t>(threadCount, 1))
+	, m_queues(new Queue[m_queueCount])
+{
+	for (size_t i = 1; i < m_queueCount; i++)
+	{
+		m_threads.emplace_back([this, i] { workerLoop(i); });
+	}
+}
+
+LayoutWorkerPool& LayoutWorkerPool::Default()
+{
+	static LayoutWorkerPool pool;
+	return pool;
+}
+
+LayoutWorkerPool::~LayoutWorkerPool()
+{
+	{
+		std::lock_guard lock{ m_mutex };
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void LayoutWorkerPool::run(size_t taskCount, const std::function<void(size_t)>& task)
+{
+	if (taskCount == 0)
+	{
+		return;
+	}
+
+	// タスクの中から同じプールを使った場合は、そのスレッドで順に実行する
+	if (m_threads.empty() || taskCount == 1 || CurrentPool == this)
+	{
+		for (size_t i = 0; i < taskCount; i++)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	std::lock_guard runLock{ m_runMutex };
+
+	m_task = &task;
+	m_remaining = taskCount;
+
+	// 各スレッドのキューへ均等に配り、偏った分は空いたスレッドが盗む
+	for (size_t i = 0; i < taskCount; i++)
+	{
+		auto& queue = m_queues[i % m_queueCount];
+		std::lock_guard lock{ queue.mutex };
+		queue.tasks.push_back(i);
+	}
+
+	{
+		std::lock_guard lock{ m_mutex };
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	work(0);
+
+	{
+		std::unique_lock lock{ m_mutex };
+		m_done.wait(lock, [this] { return m_remaining == 0; });
+	}
+
+	m_task = nullptr;
+}
+
+bool LayoutWorkerPool::tryPop(size_t self, size_t& task)
+{
+	// 自分のキューは先頭から
+	{
+		auto& queue = m_queues[self];
+		std::lock_guard lock{ queue.mutex };
+		if (not queue.tasks.empty())
+		{
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	// 他のキューからは末尾から盗む
+	for (size_t i = 1; i < m_queueCount; i++)
+	{
+		auto& queue = m_queues[(self + i) % m_queueCount];
+		std::lock_guard lock{ queue.mutex };
+		if (not queue.tasks.empty())
+		{
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void LayoutWorkerPool::work(size_t self)
+{
+	const auto previous = std::exchange(CurrentPool, this);
+
+	size_t task;
+	while (tryPop(self, task))
+	{
+		(*m_task)(task);
+
+		if (m_remaining.fetch_sub(1) == 1)
+		{
+			std::lock_guard lock{ m_mutex };
+			m_done.notify_all();
+		}
+	}
+
+	CurrentPool = previous;
+}
+
+void LayoutWorkerPool::workerLoop(size_t self)
+{
+	uint64 generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock{ m_mutex };
+			m_wake.wait(lock, [&] { return m_stop || m_generation != generation; });
+
+			if (m_stop)
+			{
+				return;
+			}
+
+			generation = m_generation;
+		}
+
+		work(self);
+	}
+}
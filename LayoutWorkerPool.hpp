@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+
+// レイアウト計算用のワークスティーリング方式のスレッドプール
+class LayoutWorkerPool
+{
+public:
+
+	// threadCountは呼び出し元のスレッドを含む数
+	explicit LayoutWorkerPool(size_t threadCount = Max<size_t>(std::thread::hardware_concurrency(), 1));
+
+	LayoutWorkerPool(const LayoutWorkerPool&) = delete;
+
+	LayoutWorkerPool& operator=(const LayoutWorkerPool&) = delete;
+
+	static LayoutWorkerPool& Default();
+
+public:
+
+	size_t threadCount() const noexcept { return m_queueCount; }
+
+	// task(0) ... task(taskCount - 1) を並列に実行し、全て終わるまで待つ
+	// 呼び出し元のスレッドも処理に加わる。タスクの中から呼んだ場合は順に実行する
+	void run(size_t taskCount, const std::function<void(size_t)>& task);
+
+	~LayoutWorkerPool();
+
+private:
+
+	struct Queue
+	{
+		std::mutex mutex;
+
+		std::deque<size_t> tasks;
+	};
+
+	const size_t m_queueCount;
+
+	// [0]は呼び出し元のスレッド用
+	std::unique_ptr<Queue[]> m_queues;
+
+	Array<std::thread> m_threads;
+
+	std::mutex m_runMutex;
+
+	std::mutex m_mutex;
+
+	std::condition_variable m_wake;
+
+	std::condition_variable m_done;
+
+	const std::function<void(size_t)>* m_task = nullptr;
+
+	uint64 m_generation = 0;
+
+	std::atomic<size_t> m_remaining = 0;
+
+	bool m_stop = false;
+
+	bool tryPop(size_t self, size_t& task);
+
+	void work(size_t self);
+
+	void workerLoop(size_t self);
+};
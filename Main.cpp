@@ -5,8 +5,12 @@
 #include "Widget.hpp"
 #include "LayoutTree.hpp"
 #include "WidgetTreeEditor.hpp"
+#include "LayoutProfilerPanel.hpp"
 
 #include "Label.hpp"
+#include "WidgetSnapshot.hpp"
+
+#if !defined(SIV3D_YOGA_BENCHMARK) && !defined(SIV3D_YOGA_TEST)
 
 void Main()
 {
@@ -16,25 +20,48 @@ void Main()
 
 	constexpr int32 Padding = 50;
 
+	// Ctrl+Sで保存したUIとレイアウト結果。あればcreateUIの代わりに使うので、createUIを変えたら消す
+	constexpr FilePathView SnapshotPath = U"layout.snapshot";
+
+	auto createUI = [](WidgetPool& pool)
+		{
+			auto rootWidget = pool.create<Widget>();
+
+			// labelWidgetを中央に配置
+			rootWidget->style().setJustifyContent(facebook::yoga::Justify::Center);
+			rootWidget->style().setAlignItems(facebook::yoga::Align::Center);
+
+			// labelWidgetをrootWidgetに追加
+			auto labelWidget = pool.create<Label>();
+			labelWidget->setText(U"Siv3DYogaTest");
+			labelWidget->setColor(Palette::Black);
+			rootWidget->appendChild(std::move(labelWidget));
+
+			return rootWidget;
+		};
+
+	// スナップショットがあれば、最初のフレームはそれを描き、UIの構築は次のフレームで行う
+	WidgetSnapshot snapshot{ SnapshotPath };
+	bool previewDrawn = false;
+
 	// UI
-	auto rootWidget = std::make_shared<Widget>();
-	{
-		// labelWidgetを中央に配置
-		rootWidget->style().setJustifyContent(facebook::yoga::Justify::Center);
-		rootWidget->style().setAlignItems(facebook::yoga::Align::Center);
-
-		// labelWidgetをrootWidgetに追加
-		auto labelWidget = std::make_shared<Label>();
-		labelWidget->setText(U"Siv3DYogaTest");
-		labelWidget->setColor(Palette::Black);
-		rootWidget->children.emplace_back(std::move(labelWidget));
-	}
+	std::shared_ptr<Widget> rootWidget;
 
 	// UIを編集するエディタ
-	WidgetTreeEditor editor{ rootWidget };
-	
-	// UIからLayoutTreeを構築
-	LayoutTree tree{ rootWidget };
+	std::unique_ptr<WidgetTreeEditor> editor;
+
+	// レイアウトの内訳。LayoutTreeより後に破棄されるよう先に作る
+	LayoutProfiler profiler;
+
+	LayoutTree tree;
+	tree.setProfiler(&profiler);
+
+	LayoutProfilerPanel profilerPanel{ tree, profiler };
+
+	Size layoutSize{ 0, 0 };
+
+	// 毎フレームの検索結果。使い回して確保を避ける
+	Array<std::shared_ptr<Widget>> redWidgets;
 
 	while (System::Update())
 	{
@@ -44,23 +71,68 @@ void Main()
 
 		Transformer2D tf{ Mat3x2::Translate(rect.pos), TransformCursor::Yes };
 
-		// レイアウトを計算
-		tree.calculateLayout(rect.size);
+		if (not rootWidget)
+		{
+			// 保存時と同じ大きさなら、レイアウトせずに保存済みの結果を描く
+			if (snapshot && not previewDrawn && snapshot.layoutSize() == SizeF{ rect.size })
+			{
+				snapshot.draw();
+				previewDrawn = true;
+			}
+			else
+			{
+				// Widgetはこのツリーのプールから作り、削除したものの領域は次に追加するWidgetで使い回す
+				const auto& pool = tree.widgetPool();
+				rootWidget = snapshot ? snapshot.instantiate(pool.get()) : createUI(*pool);
+				snapshot.close();
+
+				editor = std::make_unique<WidgetTreeEditor>(tree, rootWidget, pool);
 
-		// nameが"red"のウィジェットを列挙して赤い四角を描画
-		for (auto widget : rootWidget->queryAll(U"red"))
+				// UIからLayoutTreeを構築
+				tree.construct(rootWidget);
+			}
+		}
+
+		if (rootWidget)
 		{
-			widget->layoutResults()->rect().draw(Palette::Red);
+			// レイアウトを計算
+			tree.calculateLayout(rect.size);
+			layoutSize = rect.size;
+
+			// nameが"red"のウィジェットを列挙して赤い四角を描画
+			rootWidget->queryAll(U"red", redWidgets);
+			for (auto& widget : redWidgets)
+			{
+				if (auto layout = widget->layoutResults())
+				{
+					layout->rect().draw(Palette::Red);
+				}
+			}
+			redWidgets.clear();
+
+			// ウィジェットを描画
+			rootWidget->draw();
 		}
 
-		// ウィジェットを描画
-		rootWidget->draw();
+		// レイアウトの内訳を表示
+		profilerPanel.update();
 
-		// UIを編集
-		if (editor.update())
+		if (editor)
 		{
-			// 変更があったらLayoutTreeを再構築
-			tree.construct(rootWidget);
+			// UIを編集
+			if (editor->update())
+			{
+				// 変更があったらLayoutTreeを再構築
+				tree.construct(rootWidget);
+			}
+
+			// Ctrl+Sで今の状態を保存する。終了時には保存しない
+			if (KeyControl.pressed() && KeyS.down())
+			{
+				WidgetSnapshot::Save(SnapshotPath, *rootWidget, layoutSize);
+			}
 		}
 	}
 }
+
+#endif
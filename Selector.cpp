@@ -0,0 +1,360 @@
+﻿#include "Selector.hpp"
+#include "Widget.hpp"
+#include "LayoutTree.hpp"
+
+namespace
+{
+	constexpr StringView NthChildPrefix = U":nth-child(";
+
+	bool IsIdentifierChar(char32 ch)
+	{
+		return not (IsSpace(ch) || ch == U'>' || ch == U'#' || ch == U':' || ch == U'*' || ch == U'(' || ch == U')');
+	}
+
+	Optional<int32> ParseInteger(StringView text)
+	{
+		if (text.isEmpty())
+		{
+			return none;
+		}
+
+		if (text.front() == U'+')
+		{
+			text.remove_prefix(1);
+		}
+
+		return ParseOpt<int32>(text);
+	}
+}
+
+bool Selector::NthChild::matches(size_t index) const
+{
+	if (a == 0)
+	{
+		return static_cast<int64>(index) == b;
+	}
+
+	// index = a * n + b (n >= 0)
+	const int64 diff = static_cast<int64>(index) - b;
+	return (diff % a == 0) && (diff / a >= 0);
+}
+
+Optional<Selector> Selector::Compile(StringView text)
+{
+	Selector selector;
+	selector.m_text = text;
+
+	size_t i = 0;
+	const size_t length = text.size();
+
+	auto skipSpaces = [&]
+		{
+			const size_t begin = i;
+			while (i < length && IsSpace(text[i]))
+			{
+				i++;
+			}
+			return i != begin;
+		};
+
+	auto readIdentifier = [&]
+		{
+			const size_t begin = i;
+			while (i < length && IsIdentifierChar(text[i]))
+			{
+				i++;
+			}
+			return text.substr(begin, i - begin);
+		};
+
+	Combinator combinator = Combinator::None;
+	skipSpaces();
+
+	while (i < length)
+	{
+		Compound compound;
+		compound.combinator = combinator;
+		bool empty = true;
+
+		if (text[i] == U'*')
+		{
+			i++;
+			empty = false;
+		}
+		else if (IsIdentifierChar(text[i]))
+		{
+			compound.typeName = readIdentifier();
+			empty = false;
+		}
+
+		while (i < length)
+		{
+			if (text[i] == U'#')
+			{
+				i++;
+
+				const auto name = readIdentifier();
+				if (name.isEmpty())
+				{
+					return none;
+				}
+
+				// 後から名前を付けられたWidgetにも一致するよう登録しておく (Selectorを破棄すると外れる)
+				auto interned = WidgetName::Intern(name);
+				if (compound.name && compound.name->get() != interned.get())
+				{
+					return none;
+				}
+
+				compound.name = std::move(interned);
+			}
+			else if (text.substr(i).starts_with(NthChildPrefix))
+			{
+				i += NthChildPrefix.size();
+
+				const size_t close = text.indexOf(U')', i);
+				if (close == StringView::npos)
+				{
+					return none;
+				}
+
+				const auto nthChild = ParseNthChild(text.substr(i, close - i));
+				if (not nthChild)
+				{
+					return none;
+				}
+
+				compound.nthChildren.push_back(*nthChild);
+				i = close + 1;
+			}
+			else
+			{
+				break;
+			}
+
+			empty = false;
+		}
+
+		if (empty)
+		{
+			return none;
+		}
+
+		selector.m_compounds.push_back(std::move(compound));
+
+		const bool space = skipSpaces();
+		if (i == length)
+		{
+			break;
+		}
+
+		if (text[i] == U'>')
+		{
+			i++;
+			skipSpaces();
+			combinator = Combinator::Child;
+		}
+		else if (space)
+		{
+			combinator = Combinator::Descendant;
+		}
+		else
+		{
+			return none;
+		}
+
+		// 末尾の結合子
+		if (i == length)
+		{
+			return none;
+		}
+	}
+
+	if (selector.m_compounds.empty())
+	{
+		return none;
+	}
+
+	return selector;
+}
+
+bool Selector::matches(const Widget& widget) const
+{
+	return matchesFrom(m_compounds.size() - 1, widget, none);
+}
+
+void Selector::queryAll(Widget& scope, Array<Widget*>& result, size_t limit) const
+{
+	const auto& last = m_compounds.back();
+
+	// 名前の索引から候補を引けば、一致しうるWidgetだけを確かめればよい
+	if (last.name && scope.m_nameIndex)
+	{
+		for (Widget* widget : scope.m_nameIndex->namedWidgets(last.name->get(), scope))
+		{
+			if (result.size() >= limit)
+			{
+				return;
+			}
+
+			if (matches(*widget))
+			{
+				result.push_back(widget);
+			}
+		}
+
+		return;
+	}
+
+	collect(scope, none, result, limit);
+}
+
+Optional<Selector::NthChild> Selector::ParseNthChild(StringView text)
+{
+	const String expression = String{ text }.removed(U' ').lowercased();
+
+	if (expression == U"odd")
+	{
+		return NthChild{ .a = 2, .b = 1 };
+	}
+
+	if (expression == U"even")
+	{
+		return NthChild{ .a = 2, .b = 0 };
+	}
+
+	const size_t n = expression.indexOf(U'n');
+	if (n == String::npos)
+	{
+		if (auto b = ParseInteger(expression))
+		{
+			return NthChild{ .a = 0, .b = *b };
+		}
+
+		return none;
+	}
+
+	const StringView aText = StringView{ expression }.substr(0, n);
+	const StringView bText = StringView{ expression }.substr(n + 1);
+
+	NthChild nthChild;
+
+	if (aText.isEmpty() || aText == U"+")
+	{
+		nthChild.a = 1;
+	}
+	else if (aText == U"-")
+	{
+		nthChild.a = -1;
+	}
+	else if (auto a = ParseInteger(aText))
+	{
+		nthChild.a = *a;
+	}
+	else
+	{
+		return none;
+	}
+
+	if (not bText.isEmpty())
+	{
+		auto b = ParseInteger(bText);
+		if (not b)
+		{
+			return none;
+		}
+
+		nthChild.b = *b;
+	}
+
+	return nthChild;
+}
+
+bool Selector::matchesCompound(const Compound& compound, const Widget& widget, Optional<size_t> childIndex) const
+{
+	// 名前は集約されているのでアドレスで比べる
+	if (compound.name && &widget.name() != compound.name->get())
+	{
+		return false;
+	}
+
+	if (not compound.typeName.isEmpty() && widget.typeName() != compound.typeName)
+	{
+		return false;
+	}
+
+	if (not compound.nthChildren.empty())
+	{
+		const Widget* parent = widget.parent();
+		if (not parent)
+		{
+			return false;
+		}
+
+		if (not childIndex)
+		{
+			auto it = std::find_if(parent->children().begin(), parent->children().end(),
+				[&](const std::shared_ptr<Widget>& child) { return child.get() == &widget; });
+			childIndex = static_cast<size_t>(it - parent->children().begin());
+		}
+
+		for (auto& nthChild : compound.nthChildren)
+		{
+			if (not nthChild.matches(*childIndex + 1))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool Selector::matchesFrom(size_t compoundIndex, const Widget& widget, Optional<size_t> childIndex) const
+{
+	const auto& compound = m_compounds[compoundIndex];
+
+	if (not matchesCompound(compound, widget, childIndex))
+	{
+		return false;
+	}
+
+	if (compoundIndex == 0)
+	{
+		return true;
+	}
+
+	if (compound.combinator == Combinator::Child)
+	{
+		const Widget* parent = widget.parent();
+		return parent && matchesFrom(compoundIndex - 1, *parent, none);
+	}
+
+	for (const Widget* ancestor = widget.parent(); ancestor; ancestor = ancestor->parent())
+	{
+		if (matchesFrom(compoundIndex - 1, *ancestor, none))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Selector::collect(Widget& widget, Optional<size_t> childIndex, Array<Widget*>& result, size_t limit) const
+{
+	if (result.size() >= limit)
+	{
+		return;
+	}
+
+	if (matchesFrom(m_compounds.size() - 1, widget, childIndex))
+	{
+		result.push_back(&widget);
+	}
+
+	for (size_t i = 0; i < widget.children().size(); i++)
+	{
+		collect(*widget.children()[i], i, result, limit);
+	}
+}
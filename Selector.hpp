@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "WidgetName.hpp"
+
+class Widget;
+
+// CSSに似たセレクタを解析し、Widgetを探す手順にしたもの
+//
+// Label                 typeName()がLabelのWidget (*で全て)
+// #title                名前がtitleのWidget
+// :nth-child(2n+1)      親の何番目の子か (1から数える。odd, even, 整数も書ける)
+// Widget Label          Widgetの子孫のLabel
+// Widget > Label        Widgetの子のLabel
+//
+// 右端の部分に名前があればLayoutTreeの名前の索引から候補を引き、なければ範囲を辿る
+// 候補ごとに右から左へ祖先をたどって確かめる
+class Selector
+{
+public:
+
+	// 解析できない場合はnone
+	static Optional<Selector> Compile(StringView text);
+
+public:
+
+	const String& text() const noexcept { return m_text; }
+
+	// 祖先はscopeの外でもよい
+	bool matches(const Widget& widget) const;
+
+	// scopeとその子孫から一致するWidgetをresultの末尾に追加する (順序は不定)
+	void queryAll(Widget& scope, Array<Widget*>& result, size_t limit = Largest<size_t>) const;
+
+private:
+
+	enum class Combinator : uint8
+	{
+		// 左端の部分
+		None,
+
+		Descendant,
+
+		Child,
+	};
+
+	// an+b番目の子
+	struct NthChild
+	{
+		int32 a = 0;
+
+		int32 b = 0;
+
+		bool matches(size_t index) const;
+	};
+
+	// 空白や>で区切られた1つの部分
+	struct Compound
+	{
+		// 空の場合はどの型でもよい
+		String typeName;
+
+		// noneの場合はどの名前でもよい。参照を持つので、Selectorが残る間は登録も残る
+		Optional<WidgetName::Reference> name;
+
+		Array<NthChild> nthChildren;
+
+		// 左の部分との関係
+		Combinator combinator = Combinator::None;
+	};
+
+	String m_text;
+
+	Array<Compound> m_compounds;
+
+	static Optional<NthChild> ParseNthChild(StringView text);
+
+	// childIndexは親の何番目の子か (0から数える)。分からなければnone
+	bool matchesCompound(const Compound& compound, const Widget& widget, Optional<size_t> childIndex) const;
+
+	bool matchesFrom(size_t compoundIndex, const Widget& widget, Optional<size_t> childIndex) const;
+
+	void collect(Widget& widget, Optional<size_t> childIndex, Array<Widget*>& result, size_t limit) const;
+};
@@ -0,0 +1,75 @@
+﻿#include "SelectorCache.hpp"
+
+const Array<Widget*>* SelectorCache::select(Widget& scope, StringView selector, uint64 version)
+{
+	const size_t key = std::hash<StringView>{}(selector) ^ (std::hash<const void*>{}(&scope) * 0x9e3779b97f4a7c15ull);
+
+	auto it = m_entries.find(key);
+	if (it != m_entries.end() &&
+		(it->second.scope != &scope || it->second.selector.text() != selector))
+	{
+		m_entries.erase(it);
+		it = m_entries.end();
+	}
+
+	if (it == m_entries.end())
+	{
+		m_stats.compiles++;
+
+		auto compiled = Selector::Compile(selector);
+		if (not compiled)
+		{
+			return nullptr;
+		}
+
+		if (m_entries.size() >= m_capacity)
+		{
+			evict(m_entries.size() - m_capacity + 1);
+		}
+
+		// 版を違えておき、下で必ず探させる
+		it = m_entries.emplace(key, Entry{ &scope, std::move(*compiled), version + 1, 0, {} }).first;
+	}
+
+	auto& entry = it->second;
+	entry.lastUsed = ++m_tick;
+
+	if (entry.version == version)
+	{
+		m_stats.hits++;
+		return &entry.result;
+	}
+
+	m_stats.misses++;
+
+	entry.result.clear();
+	entry.selector.queryAll(scope, entry.result);
+	entry.version = version;
+
+	return &entry.result;
+}
+
+void SelectorCache::clear()
+{
+	m_entries.clear();
+}
+
+void SelectorCache::setCapacity(size_t capacity)
+{
+	m_capacity = Max<size_t>(capacity, 1);
+
+	if (m_entries.size() > m_capacity)
+	{
+		evict(m_entries.size() - m_capacity);
+	}
+}
+
+void SelectorCache::evict(size_t count)
+{
+	for (size_t i = 0; i < count && not m_entries.empty(); i++)
+	{
+		auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+			[](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; });
+		m_entries.erase(oldest);
+	}
+}
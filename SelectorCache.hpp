@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "Selector.hpp"
+
+// セレクタと検索範囲ごとに、解析したSelectorと最後の結果を保持するキャッシュ
+// 版が同じ間は結果をそのまま返し、変わっていれば解析済みのSelectorで探し直す
+class SelectorCache
+{
+public:
+
+	struct Stats
+	{
+		size_t hits = 0;
+
+		size_t misses = 0;
+
+		// セレクタを解析した回数
+		size_t compiles = 0;
+	};
+
+	static constexpr size_t DefaultCapacity = 64;
+
+	explicit SelectorCache(size_t capacity = DefaultCapacity)
+		: m_capacity(Max<size_t>(capacity, 1)) { }
+
+public:
+
+	// 解析できないセレクタはnullptr
+	// 結果は次にselectを呼ぶまで有効
+	const Array<Widget*>* select(Widget& scope, StringView selector, uint64 version);
+
+	void clear();
+
+	size_t capacity() const noexcept { return m_capacity; }
+
+	// 容量を超えた場合は最も長く使われていないものを捨てる
+	void setCapacity(size_t capacity);
+
+	size_t size() const noexcept { return m_entries.size(); }
+
+	const Stats& stats() const noexcept { return m_stats; }
+
+	void resetStats() noexcept { m_stats = { }; }
+
+private:
+
+	struct Entry
+	{
+		const Widget* scope;
+
+		Selector selector;
+
+		uint64 version;
+
+		uint64 lastUsed;
+
+		Array<Widget*> result;
+	};
+
+	size_t m_capacity;
+
+	uint64 m_tick = 0;
+
+	// セレクタの文字列と範囲のハッシュ。衝突した場合は置き換える
+	HashTable<size_t, Entry> m_entries;
+
+	Stats m_stats;
+
+	void evict(size_t count);
+};
@@ -0,0 +1,85 @@
+﻿#include "SelectorCache.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+#include "Selector.hpp"
+#include "Label.hpp"
+
+namespace
+{
+	constexpr size_t NodeCount = 2'000;
+
+	const std::array<StringView, 5> Selectors{
+		U"Widget > Label:nth-child(2n+1)",
+		U"Label",
+		U"Widget Widget",
+		U"#red",
+		U"Widget > #red:nth-child(3n)",
+	};
+
+	// キャッシュから返した結果を、毎回解析して探した結果と並びまで比べる
+	void CompareWithFresh(LayoutTree& tree, Widget& scope, StringView step, Array<String>& failures)
+	{
+		for (const auto selector : Selectors)
+		{
+			Array<Widget*> fresh;
+			Selector::Compile(selector)->queryAll(scope, fresh);
+
+			// 1回目は探してキャッシュに入れ、2回目はキャッシュから返る
+			for (size_t i = 0; i < 2; i++)
+			{
+				const auto* cached = tree.select(selector, &scope);
+
+				if (not cached || *cached != fresh)
+				{
+					failures << U"{}: \"{}\" returned {} widgets from the cache, {} from a fresh query"_fmt(
+						step, selector, cached ? cached->size() : 0, fresh.size());
+				}
+			}
+		}
+	}
+
+	const UnitTest::Registration SelectorCacheTest{ U"SelectorCache", [](Array<String>& failures)
+		{
+			const auto root = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Cards, NodeCount);
+			LayoutTree tree{ root };
+
+			CompareWithFresh(tree, *root, U"initial", failures);
+
+			// 名前を付けると、構成は同じでも結果が変わる
+			size_t index = 0;
+			for (auto& card : root->children())
+			{
+				for (auto& label : card->children())
+				{
+					if (index++ % 7 == 0)
+					{
+						label->setName(U"red");
+					}
+				}
+			}
+
+			CompareWithFresh(tree, *root, U"after rename", failures);
+
+			// カードを取り除き、名前付きのLabelを持つカードを足す
+			const auto removed = root->children().front();
+			root->removeChild(removed);
+
+			auto card = std::make_shared<Widget>();
+			for (size_t i = 0; i < 4; i++)
+			{
+				auto label = std::make_shared<Label>();
+				label->setText(U"Added {}"_fmt(i));
+				label->setName(U"red");
+				card->appendChild(std::move(label));
+			}
+			root->appendChild(card);
+
+			CompareWithFresh(tree, *root, U"after edit", failures);
+			CompareWithFresh(tree, *card, U"scoped", failures);
+		} };
+}
+
+#endif
@@ -0,0 +1,199 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+
+// 要素を連続した領域に持つ可変長配列
+// InlineCapacity個までは自身の中に持ち、ヒープを使わない
+template <class Type, size_t InlineCapacity>
+class SmallVector
+{
+	static_assert(InlineCapacity > 0);
+
+public:
+
+	using value_type = Type;
+
+	using size_type = size_t;
+
+	using difference_type = std::ptrdiff_t;
+
+	using reference = Type&;
+
+	using const_reference = const Type&;
+
+	using iterator = Type*;
+
+	using const_iterator = const Type*;
+
+	using reverse_iterator = std::reverse_iterator<iterator>;
+
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	SmallVector() noexcept = default;
+
+	SmallVector(const SmallVector&) = delete;
+
+	SmallVector& operator=(const SmallVector&) = delete;
+
+	SmallVector(SmallVector&& other) noexcept
+	{
+		moveFrom(other);
+	}
+
+	SmallVector& operator=(SmallVector&& other) noexcept
+	{
+		if (this != &other)
+		{
+			clear();
+			release();
+			moveFrom(other);
+		}
+		return *this;
+	}
+
+	~SmallVector()
+	{
+		clear();
+		release();
+	}
+
+public:
+
+	size_t size() const noexcept { return m_size; }
+
+	size_t capacity() const noexcept { return m_capacity; }
+
+	bool empty() const noexcept { return m_size == 0; }
+
+	Type* data() noexcept { return m_data; }
+
+	const Type* data() const noexcept { return m_data; }
+
+	iterator begin() noexcept { return m_data; }
+
+	iterator end() noexcept { return m_data + m_size; }
+
+	const_iterator begin() const noexcept { return m_data; }
+
+	const_iterator end() const noexcept { return m_data + m_size; }
+
+	reverse_iterator rbegin() noexcept { return reverse_iterator{ end() }; }
+
+	reverse_iterator rend() noexcept { return reverse_iterator{ begin() }; }
+
+	const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator{ end() }; }
+
+	const_reverse_iterator rend() const noexcept { return const_reverse_iterator{ begin() }; }
+
+	Type& operator[](size_t index) noexcept { return m_data[index]; }
+
+	const Type& operator[](size_t index) const noexcept { return m_data[index]; }
+
+	Type& front() noexcept { return m_data[0]; }
+
+	const Type& front() const noexcept { return m_data[0]; }
+
+	Type& back() noexcept { return m_data[m_size - 1]; }
+
+	const Type& back() const noexcept { return m_data[m_size - 1]; }
+
+	void reserve(size_t capacity)
+	{
+		if (capacity <= m_capacity)
+		{
+			return;
+		}
+
+		Type* data = static_cast<Type*>(::operator new(capacity * sizeof(Type), std::align_val_t{ alignof(Type) }));
+		std::uninitialized_move(begin(), end(), data);
+		std::destroy(begin(), end());
+		release();
+
+		m_data = data;
+		m_capacity = capacity;
+	}
+
+	void push_back(Type value)
+	{
+		if (m_size == m_capacity)
+		{
+			reserve(m_capacity * 2);
+		}
+
+		new (m_data + m_size) Type(std::move(value));
+		m_size++;
+	}
+
+	iterator insert(const_iterator position, Type value)
+	{
+		const size_t index = position - begin();
+		push_back(std::move(value));
+		std::rotate(begin() + index, end() - 1, end());
+		return begin() + index;
+	}
+
+	iterator erase(const_iterator position)
+	{
+		const size_t index = position - begin();
+		std::move(begin() + index + 1, end(), begin() + index);
+		pop_back();
+		return begin() + index;
+	}
+
+	void pop_back() noexcept
+	{
+		m_size--;
+		std::destroy_at(m_data + m_size);
+	}
+
+	void clear() noexcept
+	{
+		std::destroy(begin(), end());
+		m_size = 0;
+	}
+
+private:
+
+	Type* m_data = reinterpret_cast<Type*>(m_inline);
+
+	size_t m_size = 0;
+
+	size_t m_capacity = InlineCapacity;
+
+	alignas(Type) std::byte m_inline[sizeof(Type) * InlineCapacity];
+
+	bool isInline() const noexcept { return m_data == reinterpret_cast<const Type*>(m_inline); }
+
+	// 要素は破棄済みであること
+	void release() noexcept
+	{
+		if (not isInline())
+		{
+			::operator delete(m_data, std::align_val_t{ alignof(Type) });
+		}
+
+		m_data = reinterpret_cast<Type*>(m_inline);
+		m_capacity = InlineCapacity;
+	}
+
+	// thisは空であること
+	void moveFrom(SmallVector& other) noexcept
+	{
+		if (other.isInline())
+		{
+			std::uninitialized_move(other.begin(), other.end(), m_data);
+			m_size = other.m_size;
+			other.clear();
+		}
+		else
+		{
+			// ヒープの領域はそのまま引き取る
+			m_data = other.m_data;
+			m_size = other.m_size;
+			m_capacity = other.m_capacity;
+
+			other.m_data = reinterpret_cast<Type*>(other.m_inline);
+			other.m_size = 0;
+			other.m_capacity = InlineCapacity;
+		}
+	}
+};
@@ -0,0 +1,154 @@
+﻿#include "StyleClass.hpp"
+
+using namespace facebook;
+
+namespace
+{
+	struct Registry
+	{
+		std::mutex mutex;
+
+		// 内容のハッシュごとの登録済みスタイル
+		HashTable<size_t, Array<StyleClass::Pointer>> interned;
+
+		HashTable<String, StyleClass::Pointer> named;
+
+		size_t count = 0;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	void HashCombine(size_t& seed, size_t value)
+	{
+		seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+
+	void HashLength(size_t& seed, yoga::StyleLength value)
+	{
+		HashCombine(seed, static_cast<size_t>(value.unit()));
+		HashCombine(seed, std::hash<float>{}(value.value().unwrap()));
+	}
+
+	// 一致判定はyoga::Style::operator==で行うので、よく変わる項目だけを混ぜる
+	size_t HashStyle(const yoga::Style& style)
+	{
+		size_t seed = 0;
+
+		HashCombine(seed, static_cast<size_t>(style.flexDirection()));
+		HashCombine(seed, static_cast<size_t>(style.justifyContent()));
+		HashCombine(seed, static_cast<size_t>(style.alignItems()));
+		HashCombine(seed, static_cast<size_t>(style.flexWrap()));
+		HashCombine(seed, static_cast<size_t>(style.positionType()));
+		HashCombine(seed, static_cast<size_t>(style.display()));
+		HashCombine(seed, std::hash<float>{}(style.flexGrow().unwrap()));
+
+		for (auto dimension : { yoga::Dimension::Width, yoga::Dimension::Height })
+		{
+			HashLength(seed, style.dimension(dimension));
+		}
+
+		for (auto edge : { yoga::Edge::Left, yoga::Edge::Top, yoga::Edge::All })
+		{
+			HashLength(seed, style.margin(edge));
+			HashLength(seed, style.padding(edge));
+			HashLength(seed, style.border(edge));
+		}
+
+		return seed;
+	}
+
+	StyleClass::Pointer InternLocked(Registry& registry, const yoga::Style& style)
+	{
+		auto& bucket = registry.interned[HashStyle(style)];
+
+		for (auto& pointer : bucket)
+		{
+			if (*pointer == style)
+			{
+				return pointer;
+			}
+		}
+
+		bucket.push_back(std::make_shared<const yoga::Style>(style));
+		registry.count++;
+		return bucket.back();
+	}
+}
+
+const StyleClass::Pointer& StyleClass::Default()
+{
+	static const Pointer style = Intern(yoga::Style{});
+	return style;
+}
+
+StyleClass::Pointer StyleClass::Intern(const yoga::Style& style)
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	return InternLocked(registry, style);
+}
+
+StyleClass::Pointer StyleClass::Register(StringView name, const yoga::Style& style)
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	auto pointer = InternLocked(registry, style);
+	registry.named.insert_or_assign(String{ name }, pointer);
+	return pointer;
+}
+
+StyleClass::Pointer StyleClass::Get(StringView name)
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	if (auto it = registry.named.find(String{ name });
+		it != registry.named.end())
+	{
+		return it->second;
+	}
+
+	return nullptr;
+}
+
+size_t StyleClass::Collect()
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	size_t removed = 0;
+
+	for (auto it = registry.interned.begin(); it != registry.interned.end();)
+	{
+		// 登録簿だけが持っているもの。名前付きのものはnamedも持っているので残る
+		const size_t before = it->second.size();
+		it->second.remove_if([](const Pointer& pointer) { return pointer.use_count() == 1; });
+		removed += before - it->second.size();
+
+		if (it->second.empty())
+		{
+			registry.interned.erase(it++);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	registry.count -= removed;
+	return removed;
+}
+
+size_t StyleClass::Count()
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	return registry.count;
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include <yoga/style/Style.h>
+
+// 複数のWidgetで共有する変更できないスタイル
+// Widgetは個別に書き換えるときだけ複製する
+class StyleClass
+{
+public:
+
+	using Pointer = std::shared_ptr<const facebook::yoga::Style>;
+
+	// 既定値のスタイル
+	static const Pointer& Default();
+
+	// 内容が同じスタイルが登録済みであればそれを返し、なければ登録する
+	static Pointer Intern(const facebook::yoga::Style& style);
+
+	// 名前を付けて登録する。同じ名前で登録し直した場合、既に使っているWidgetは古いスタイルのまま
+	static Pointer Register(StringView name, const facebook::yoga::Style& style);
+
+	// 名前で登録されたスタイル。なければnullptr
+	static Pointer Get(StringView name);
+
+	// どのWidgetからも使われていないスタイルを捨てる
+	static size_t Collect();
+
+	// 登録されているスタイルの数
+	static size_t Count();
+};
@@ -0,0 +1,302 @@
+﻿#include "StyleFormat.hpp"
+
+using namespace facebook;
+
+namespace
+{
+	using Property = StyleFormat::Property;
+	using Value = StyleFormat::Value;
+
+	std::optional<yoga::StyleLength> ToLength(const Value& value)
+	{
+		if (value.number)
+		{
+			return yoga::StyleLength::points(static_cast<float>(*value.number));
+		}
+
+		return StyleFormat::TryParseLength(value.text);
+	}
+
+	std::optional<yoga::FloatOptional> ToFloat(const Value& value)
+	{
+		if (value.number)
+		{
+			return yoga::FloatOptional{ static_cast<float>(*value.number) };
+		}
+
+		if (value.text.empty() || value.text == "undefined")
+		{
+			return yoga::FloatOptional{ };
+		}
+
+		return std::nullopt;
+	}
+
+	std::optional<std::string> FormatFloat(yoga::FloatOptional value, yoga::FloatOptional defaultValue)
+	{
+		if (value == defaultValue)
+		{
+			return std::nullopt;
+		}
+
+		return value.isDefined() ? fmt::format("{}", value.unwrap()) : "undefined";
+	}
+
+	template<class Type>
+	Property EnumProperty(std::string_view name, Type(yoga::Style::* getter)() const, void (yoga::Style::* setter)(Type))
+	{
+		return{
+			name,
+			[=](const yoga::Style& style) -> std::optional<std::string>
+			{
+				const Type value = (style.*getter)();
+				if (value == (yoga::Style{}.*getter)())
+				{
+					return std::nullopt;
+				}
+				return yoga::toString(value);
+			},
+			[=](yoga::Style& style, const Value& value)
+			{
+				for (int32 ordinal = 0; ordinal < yoga::ordinalCount<Type>(); ordinal++)
+				{
+					const Type choice = static_cast<Type>(ordinal);
+					if (value.text == yoga::toString(choice))
+					{
+						(style.*setter)(choice);
+						return true;
+					}
+				}
+				return false;
+			},
+		};
+	}
+
+	Property FloatProperty(std::string_view name, yoga::FloatOptional(yoga::Style::* getter)() const, void (yoga::Style::* setter)(yoga::FloatOptional))
+	{
+		return{
+			name,
+			[=](const yoga::Style& style)
+			{
+				return FormatFloat((style.*getter)(), (yoga::Style{}.*getter)());
+			},
+			[=](yoga::Style& style, const Value& value)
+			{
+				if (auto v = ToFloat(value))
+				{
+					(style.*setter)(*v);
+					return true;
+				}
+				return false;
+			},
+		};
+	}
+
+	Property LengthProperty(std::string_view name, yoga::StyleLength(yoga::Style::* getter)() const, void (yoga::Style::* setter)(yoga::StyleLength))
+	{
+		return{
+			name,
+			[=](const yoga::Style& style) -> std::optional<std::string>
+			{
+				const auto value = (style.*getter)();
+				if (value == (yoga::Style{}.*getter)())
+				{
+					return std::nullopt;
+				}
+				return StyleFormat::FormatLength(value);
+			},
+			[=](yoga::Style& style, const Value& value)
+			{
+				if (auto v = ToLength(value))
+				{
+					(style.*setter)(*v);
+					return true;
+				}
+				return false;
+			},
+		};
+	}
+
+	// 辺や寸法などを引数に取る項目
+	template<class Key>
+	Property KeyedLengthProperty(std::string_view name, Key key, yoga::StyleLength(yoga::Style::* getter)(Key) const, void (yoga::Style::* setter)(Key, yoga::StyleLength))
+	{
+		return{
+			name,
+			[=](const yoga::Style& style) -> std::optional<std::string>
+			{
+				const auto value = (style.*getter)(key);
+				if (value == (yoga::Style{}.*getter)(key))
+				{
+					return std::nullopt;
+				}
+				return StyleFormat::FormatLength(value);
+			},
+			[=](yoga::Style& style, const Value& value)
+			{
+				if (auto v = ToLength(value))
+				{
+					(style.*setter)(key, *v);
+					return true;
+				}
+				return false;
+			},
+		};
+	}
+
+	Array<Property> CreateProperties()
+	{
+		Array<Property> properties{
+			EnumProperty("direction", &yoga::Style::direction, &yoga::Style::setDirection),
+			EnumProperty("flexDirection", &yoga::Style::flexDirection, &yoga::Style::setFlexDirection),
+			EnumProperty("justifyContent", &yoga::Style::justifyContent, &yoga::Style::setJustifyContent),
+			EnumProperty("alignContent", &yoga::Style::alignContent, &yoga::Style::setAlignContent),
+			EnumProperty("alignItems", &yoga::Style::alignItems, &yoga::Style::setAlignItems),
+			EnumProperty("alignSelf", &yoga::Style::alignSelf, &yoga::Style::setAlignSelf),
+			EnumProperty("positionType", &yoga::Style::positionType, &yoga::Style::setPositionType),
+			EnumProperty("flexWrap", &yoga::Style::flexWrap, &yoga::Style::setFlexWrap),
+			EnumProperty("overflow", &yoga::Style::overflow, &yoga::Style::setOverflow),
+			EnumProperty("display", &yoga::Style::display, &yoga::Style::setDisplay),
+			FloatProperty("flex", &yoga::Style::flex, &yoga::Style::setFlex),
+			FloatProperty("flexGrow", &yoga::Style::flexGrow, &yoga::Style::setFlexGrow),
+			FloatProperty("flexShrink", &yoga::Style::flexShrink, &yoga::Style::setFlexShrink),
+			FloatProperty("aspectRatio", &yoga::Style::aspectRatio, &yoga::Style::setAspectRatio),
+			LengthProperty("flexBasis", &yoga::Style::flexBasis, &yoga::Style::setFlexBasis),
+			KeyedLengthProperty("width", yoga::Dimension::Width, &yoga::Style::dimension, &yoga::Style::setDimension),
+			KeyedLengthProperty("height", yoga::Dimension::Height, &yoga::Style::dimension, &yoga::Style::setDimension),
+			KeyedLengthProperty("minWidth", yoga::Dimension::Width, &yoga::Style::minDimension, &yoga::Style::setMinDimension),
+			KeyedLengthProperty("minHeight", yoga::Dimension::Height, &yoga::Style::minDimension, &yoga::Style::setMinDimension),
+			KeyedLengthProperty("maxWidth", yoga::Dimension::Width, &yoga::Style::maxDimension, &yoga::Style::setMaxDimension),
+			KeyedLengthProperty("maxHeight", yoga::Dimension::Height, &yoga::Style::maxDimension, &yoga::Style::setMaxDimension),
+			KeyedLengthProperty("gap", yoga::Gutter::All, &yoga::Style::gap, &yoga::Style::setGap),
+			KeyedLengthProperty("rowGap", yoga::Gutter::Row, &yoga::Style::gap, &yoga::Style::setGap),
+			KeyedLengthProperty("columnGap", yoga::Gutter::Column, &yoga::Style::gap, &yoga::Style::setGap),
+		};
+
+		// "margin", "marginLeft", ... の名前で全ての辺を持つ
+		constexpr std::array<std::pair<yoga::Edge, std::string_view>, 9> Edges{ {
+			{ yoga::Edge::All, "" },
+			{ yoga::Edge::Left, "Left" },
+			{ yoga::Edge::Top, "Top" },
+			{ yoga::Edge::Right, "Right" },
+			{ yoga::Edge::Bottom, "Bottom" },
+			{ yoga::Edge::Start, "Start" },
+			{ yoga::Edge::End, "End" },
+			{ yoga::Edge::Horizontal, "Horizontal" },
+			{ yoga::Edge::Vertical, "Vertical" },
+		} };
+
+		// 名前はProperty::nameから参照されるので、ここで保持する
+		static std::array<std::string, Edges.size() * 4> names;
+		size_t nameIndex = 0;
+
+		auto addEdges = [&](std::string_view prefix, yoga::StyleLength(yoga::Style::* getter)(yoga::Edge) const, void (yoga::Style::* setter)(yoga::Edge, yoga::StyleLength))
+			{
+				for (auto [edge, suffix] : Edges)
+				{
+					auto& name = names[nameIndex++];
+					name = std::string{ prefix } + std::string{ suffix };
+					properties.push_back(KeyedLengthProperty(name, edge, getter, setter));
+				}
+			};
+
+		addEdges("margin", &yoga::Style::margin, &yoga::Style::setMargin);
+		addEdges("padding", &yoga::Style::padding, &yoga::Style::setPadding);
+		addEdges("border", &yoga::Style::border, &yoga::Style::setBorder);
+		addEdges("position", &yoga::Style::position, &yoga::Style::setPosition);
+
+		return properties;
+	}
+}
+
+std::optional<yoga::StyleLength> StyleFormat::TryParseLength(std::string_view input)
+{
+	constexpr auto trimCharList = " \t\v\r\n";
+
+	// 空白を取り除く(trim関数の代わり)
+	{
+		std::string::size_type left = input.find_first_not_of(trimCharList);
+		if (left != std::string::npos)
+		{
+			std::string::size_type right = input.find_last_not_of(trimCharList);
+			input = input.substr(left, right - left + 1);
+		}
+	}
+
+	// Undefined
+	if (input == "" || input == "undefined")
+	{
+		return yoga::StyleLength::undefined();
+	}
+
+	// Auto
+	if (input == "auto")
+	{
+		return yoga::StyleLength::ofAuto();
+	}
+
+	// Percent
+	if (input.ends_with('%'))
+	{
+		try
+		{
+			return yoga::StyleLength::percent(
+				std::stof(std::string{ input.substr(0, input.size() - 1) }) / 100.f
+			);
+		}
+		catch (const std::logic_error&)
+		{
+			return none;
+		}
+	}
+
+	// Point
+	try
+	{
+		return yoga::StyleLength::points(
+			std::stof(std::string{ input })
+		);
+	}
+	catch (const std::logic_error&)
+	{
+		return none;
+	}
+}
+
+std::string StyleFormat::FormatLength(yoga::StyleLength value)
+{
+	switch (value.unit())
+	{
+	case yoga::Unit::Undefined: return "undefined";
+	case yoga::Unit::Auto: return "auto";
+	case yoga::Unit::Point: return fmt::format("{}", value.value().unwrap());
+	case yoga::Unit::Percent: return fmt::format("{}%", value.value().unwrap() * 100);
+	}
+	return "";
+}
+
+const Array<StyleFormat::Property>& StyleFormat::Properties()
+{
+	static const Array<Property> properties = CreateProperties();
+	return properties;
+}
+
+const StyleFormat::Property* StyleFormat::FindProperty(std::string_view name)
+{
+	static const HashTable<std::string_view, const Property*> table = []
+		{
+			HashTable<std::string_view, const Property*> table;
+			for (auto& property : Properties())
+			{
+				table.emplace(property.name, &property);
+			}
+			return table;
+		}();
+
+	if (auto it = table.find(name); it != table.end())
+	{
+		return it->second;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include <yoga/style/Style.h>
+
+// yoga::Styleの値を文字列で読み書きする書式
+// WidgetTreeEditorの入力欄とWidgetTreeLoaderのファイルで同じ書式を使う
+class StyleFormat
+{
+public:
+
+	// 文字列か数値のどちらか
+	struct Value
+	{
+		std::string_view text;
+
+		Optional<double> number;
+	};
+
+	// "flexDirection"や"marginLeft"などの1項目
+	struct Property
+	{
+		std::string_view name;
+
+		// 既定値と同じ場合はnone
+		std::function<std::optional<std::string>(const facebook::yoga::Style&)> format;
+
+		// 値が正しくない場合はfalse
+		std::function<bool(facebook::yoga::Style&, const Value&)> parse;
+	};
+
+	// "", "undefined", "auto", "50%", "10" のいずれか
+	static std::optional<facebook::yoga::StyleLength> TryParseLength(std::string_view input);
+
+	// TryParseLengthで読み戻せる文字列
+	static std::string FormatLength(facebook::yoga::StyleLength value);
+
+	static const Array<Property>& Properties();
+
+	// なければnullptr
+	static const Property* FindProperty(std::string_view name);
+};
@@ -0,0 +1,56 @@
+﻿#include <Siv3D.hpp> // Siv3D v0.6.13
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+
+// ウィンドウを作らずに実行する
+SIV3D_SET(EngineOption::Renderer::Headless);
+
+// 使い方: Siv3DYogaTest(test).exe [テスト名の一部]
+void Main()
+{
+	Console.open();
+
+	const auto args = System::GetCommandLineArgs();
+	const StringView filter = (args.size() > 1) ? StringView{ args[1] } : StringView{};
+
+	size_t run = 0, failed = 0;
+
+	for (const auto& test : UnitTest::All())
+	{
+		if (not filter.isEmpty() && not test.name.includes(filter))
+		{
+			continue;
+		}
+
+		Array<String> failures;
+		Stopwatch sw{ StartImmediately::Yes };
+		test.run(failures);
+		run++;
+
+		if (failures)
+		{
+			failed++;
+			Console << U"FAIL {} ({:.1f}ms)"_fmt(test.name, sw.msF());
+
+			for (const auto& failure : failures)
+			{
+				Console << U"  {}"_fmt(failure);
+			}
+		}
+		else
+		{
+			Console << U"ok   {} ({:.1f}ms)"_fmt(test.name, sw.msF());
+		}
+	}
+
+	Console << U"{} tests, {} failed"_fmt(run, failed);
+
+	if (failed || (run == 0))
+	{
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+#endif
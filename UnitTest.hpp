@@ -0,0 +1,28 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+
+// Test構成 (SIV3D_YOGA_TEST) で実行する、結果が食い違っていないかのテスト
+// 各モジュールの隣の *Test.cpp で登録し、TestMain.cppがまとめて実行する
+struct UnitTest
+{
+	String name;
+
+	// 食い違いがあれば説明をfailuresに加える
+	std::function<void(Array<String>& failures)> run;
+
+	// 登録されたテスト (登録した順)
+	static Array<UnitTest>& All()
+	{
+		static Array<UnitTest> tests;
+		return tests;
+	}
+
+	// 名前空間の変数として置き、静的初期化で登録する
+	struct Registration
+	{
+		Registration(String name, std::function<void(Array<String>& failures)> run)
+		{
+			All().push_back({ std::move(name), std::move(run) });
+		}
+	};
+};
@@ -1,9 +1,91 @@
 ﻿#include "Widget.hpp"
+#include "LayoutTree.hpp"
+#include "Selector.hpp"
+#include "BoxRenderer.hpp"
 #include <yoga/node/Node.h>
 #include <yoga/event/event.h>
 
 using namespace facebook;
 
+namespace
+{
+	// 描画中のWidgetが描ける範囲 (LayoutResultsと同じ座標)。描画中でなければnone
+	Optional<RectF> DrawClip;
+
+	Mat3x2 CurrentTransform()
+	{
+		return Graphics2D::GetLocalTransform() * Graphics2D::GetCameraTransform();
+	}
+
+	// 描画先のうち、シザー矩形で切り抜かれていない範囲 (描画先の座標)
+	RectF ScreenClip()
+	{
+		const RectF screen = Rect{ Graphics2D::GetRenderTargetSize() };
+
+		if (Graphics2D::GetRasterizerState().scissorEnable)
+		{
+			return screen.getOverlap(RectF{ Graphics2D::GetScissorRect() });
+		}
+
+		return screen;
+	}
+
+	// 部分的にかかるピクセルも含める
+	Rect ToPixelRect(const RectF& rect)
+	{
+		const int32 left = static_cast<int32>(Math::Floor(rect.x));
+		const int32 top = static_cast<int32>(Math::Floor(rect.y));
+		const int32 right = static_cast<int32>(Math::Ceil(rect.x + rect.w));
+		const int32 bottom = static_cast<int32>(Math::Ceil(rect.y + rect.h));
+		return{ left, top, (right - left), (bottom - top) };
+	}
+
+	RasterizerState ScissorState()
+	{
+		RasterizerState state = Graphics2D::GetRasterizerState();
+		state.scissorEnable = true;
+		return state;
+	}
+
+	// 範囲内で、シザー矩形と描ける範囲をrectの内側に狭める
+	class ScopedDrawClip
+	{
+	public:
+
+		explicit ScopedDrawClip(const RectF& rect)
+			: m_previousClip(*DrawClip)
+			, m_previousScissor(Graphics2D::GetScissorRect())
+			, m_screenClip(ScreenClip())
+			, m_state(ScissorState())
+		{
+			const RectF scissor = CurrentTransform().transformRect(rect).boundingRect().getOverlap(m_screenClip);
+			Graphics2D::SetScissorRect(ToPixelRect(scissor));
+			DrawClip = DrawClip->getOverlap(rect);
+		}
+
+		ScopedDrawClip(const ScopedDrawClip&) = delete;
+
+		ScopedDrawClip& operator=(const ScopedDrawClip&) = delete;
+
+		~ScopedDrawClip()
+		{
+			Graphics2D::SetScissorRect(m_previousScissor);
+			DrawClip = m_previousClip;
+		}
+
+	private:
+
+		RectF m_previousClip;
+
+		Rect m_previousScissor;
+
+		// シザー矩形を有効にする前に求める
+		RectF m_screenClip;
+
+		ScopedRenderStates2D m_state;
+	};
+}
+
 Widget* Widget::GetInstance(const yoga::Node& node)
 {
 	return reinterpret_cast<Widget*>(node.getContext());
@@ -16,40 +98,83 @@ Widget* Widget::GetInstance(const YGNodeConstRef node)
 
 yoga::Style& Widget::style()
 {
-	if (m_node)
+	if (usesNodeStyle())
 	{
 		return m_node->getStyle();
 	}
 	else
 	{
-		return m_styleCache;
+		return ownStyle();
 	}
 }
 
 const facebook::yoga::Style& Widget::style() const
 {
-	if (m_node)
+	if (usesNodeStyle())
 	{
 		return m_node->getStyle();
 	}
 	else
 	{
-		return m_styleCache;
+		return *m_style;
 	}
 }
 
 void Widget::setStyle(const yoga::Style& style)
 {
-	if (m_node)
+	if (usesNodeStyle())
 	{
 		m_node->setStyle(style);
 	}
 	else
 	{
-		m_styleCache = style;
+		ownStyle() = style;
+	}
+}
+
+void Widget::setStyleClass(StyleClass::Pointer style)
+{
+	m_style = style ? std::move(style) : StyleClass::Default();
+	m_ownsStyle = false;
+
+	if (usesNodeStyle())
+	{
+		m_node->setStyle(*m_style);
 	}
 }
 
+StyleClass::Pointer Widget::styleClass() const
+{
+	if (usesNodeStyle() && m_node->getStyle() != *m_style)
+	{
+		return std::make_shared<const yoga::Style>(m_node->getStyle());
+	}
+
+	if (m_ownsStyle)
+	{
+		return std::make_shared<const yoga::Style>(*m_style);
+	}
+
+	return m_style;
+}
+
+Optional<LayoutResults> Widget::layoutResults() const
+{
+	if (not m_tree)
+	{
+		return none;
+	}
+
+	auto& store = m_tree->layoutResultsStore();
+
+	if (not store.hasResults(m_layoutIndex))
+	{
+		return none;
+	}
+
+	return store.get(m_layoutIndex);
+}
+
 std::shared_ptr<Widget> Widget::query(const StringView value)
 {
 	auto result = queryAll(value, 1);
@@ -65,9 +190,88 @@ Array<std::shared_ptr<Widget>> Widget::queryAll(const StringView value, size_t l
 
 void Widget::queryAll(const StringView value, Array<std::shared_ptr<Widget>>& result, size_t limit)
 {
-	for (auto& child : children)
+	// 登録されていない名前のWidgetはない
+	const auto name = WidgetName::Find(value);
+	if (not name)
 	{
-		child->queryAll(value, result, limit);
+		return;
+	}
+
+	// 空の名前は索引に載せていないので辿る
+	if (not m_nameIndex || name == WidgetName::Empty())
+	{
+		queryAll(name, result, limit);
+		return;
+	}
+
+	// 索引にはツリー全体のWidgetが載っているので、自身とその子孫の範囲だけを引く
+	for (Widget* widget : m_nameIndex->namedWidgets(name, *this))
+	{
+		if (result.size() >= limit)
+		{
+			return;
+		}
+
+		result.push_back(widget->shared_from_this());
+	}
+}
+
+bool Widget::selectAll(const StringView selector, Array<std::shared_ptr<Widget>>& result)
+{
+	if (m_nameIndex)
+	{
+		const auto* widgets = m_nameIndex->select(selector, this);
+		if (not widgets)
+		{
+			return false;
+		}
+
+		for (Widget* widget : *widgets)
+		{
+			result.push_back(widget->shared_from_this());
+		}
+		return true;
+	}
+
+	const auto compiled = Selector::Compile(selector);
+	if (not compiled)
+	{
+		return false;
+	}
+
+	Array<Widget*> widgets;
+	compiled->queryAll(*this, widgets);
+
+	for (Widget* widget : widgets)
+	{
+		result.push_back(widget->shared_from_this());
+	}
+	return true;
+}
+
+void Widget::setName(StringView name)
+{
+	auto interned = WidgetName::Intern(name);
+	if (interned == m_name.get())
+	{
+		return;
+	}
+
+	if (m_nameIndex)
+	{
+		m_nameIndex->rename(*this, std::move(interned));
+	}
+	else
+	{
+		m_name = std::move(interned);
+	}
+}
+
+void Widget::queryAll(WidgetName::Pointer name, Array<std::shared_ptr<Widget>>& result, size_t limit)
+{
+	for (auto& child : m_children)
+	{
+		child->queryAll(name, result, limit);
 
 		if (result.size() >= limit)
 		{
@@ -80,48 +284,181 @@ void Widget::queryAll(const StringView value, Array<std::shared_ptr<Widget>>& re
 		return;
 	}
 
-	if (name == value)
+	if (m_name == name)
 	{
 		result.push_back(shared_from_this());
 	}
 }
 
-void Widget::draw()
+bool Widget::isDescendantOf(const Widget& ancestor) const
 {
-	auto& layout = layoutResults().value();
-	drawContent(layout);
-	drawBorder(layout);
+	for (const Widget* widget = this; widget; widget = widget->m_parent)
+	{
+		if (widget == &ancestor)
+		{
+			return true;
+		}
+	}
+
+	return false;
 }
 
-void Widget::markLayoutDirty()
+void Widget::appendChild(std::shared_ptr<Widget> child)
 {
-	if (m_node)
+	insertChild(m_children.size(), std::move(child));
+}
+
+void Widget::insertChild(size_t index, std::shared_ptr<Widget> child)
+{
+	assert(allowChildren());
+
+	// 他の親から付け替える
+	if (child->m_parent)
 	{
-		m_node->markDirtyAndPropagate();
+		child->m_parent->removeChild(child);
+	}
+
+	child->m_parent = this;
+
+	if (m_nameIndex)
+	{
+		m_nameIndex->indexNames(*child);
 	}
+
+	m_children.insert(m_children.begin() + Min(index, m_children.size()), std::move(child));
+
+	recordChildrenChange();
 }
 
-void Widget::drawChildren() const
+bool Widget::removeChild(const std::shared_ptr<Widget>& child)
 {
-	for (auto child : children)
+	auto it = std::find(m_children.begin(), m_children.end(), child);
+
+	if (it == m_children.end())
 	{
-		child->draw();
+		return false;
+	}
+
+	(*it)->m_parent = nullptr;
+
+	// 索引からはすぐに外し、constructまでの間も見つからないようにする
+	if (m_nameIndex)
+	{
+		m_nameIndex->unindexNames(**it);
+	}
+
+	if (m_tree)
+	{
+		m_tree->retainWhileLayout(*it);
 	}
+
+	m_children.erase(it);
+
+	recordChildrenChange();
+	return true;
 }
 
-void Widget::drawBorder(const LayoutResults& layout) const
+bool Widget::moveChild(const std::shared_ptr<Widget>& child, size_t index)
 {
-	if (borderColor.a == 0)
+	auto it = std::find(m_children.begin(), m_children.end(), child);
+
+	if (it == m_children.end())
+	{
+		return false;
+	}
+
+	auto moving = std::move(*it);
+	m_children.erase(it);
+	m_children.insert(m_children.begin() + Min(index, m_children.size()), std::move(moving));
+
+	recordChildrenChange();
+	return true;
+}
+
+void Widget::draw()
+{
+	if (not m_tree)
+	{
+		return;
+	}
+
+	const auto& store = m_tree->layoutResultsStore();
+
+	// 非同期のレイアウトで、まだ結果が公開されていない
+	if (not store.hasResults(m_layoutIndex))
 	{
 		return;
 	}
 
-	for (auto polygon : Geometry2D::Subtract(layout.rect().asPolygon(), layout.rectWithoutBorder()))
+	// 一番外側のdrawで、見えている範囲をLayoutResultsの座標へ戻す
+	const bool outermost = not DrawClip;
+	if (outermost)
+	{
+		DrawClip = CurrentTransform().inverse().transformRect(ScreenClip()).boundingRect();
+	}
+
+	// 自身も子孫も見えていなければ辿らない
+	if (store.bounds(m_layoutIndex).intersects(*DrawClip))
+	{
+		const auto layout = store.get(m_layoutIndex);
+
+		// 非constのstyle()は共有しているStyleClassを複製するので、constで読む
+		if (std::as_const(*this).style().overflow() != yoga::Overflow::Visible)
+		{
+			ScopedDrawClip clip{ layout.rectWithoutBorder() };
+			drawContent(layout);
+		}
+		else
+		{
+			drawContent(layout);
+		}
+
+		if (layout.rect().intersects(*DrawClip))
+		{
+			drawBorder(layout);
+		}
+	}
+
+	if (outermost)
+	{
+		DrawClip.reset();
+	}
+}
+
+void Widget::markLayoutDirty()
+{
+	if (m_tree)
+	{
+		// 大きさが固定された祖先で止め、そこからレイアウトし直す
+		m_tree->markDirty(*this);
+	}
+	else if (m_node)
+	{
+		m_node->markDirtyAndPropagate();
+	}
+}
+
+void Widget::recordMeasure() const
+{
+	if (m_tree)
+	{
+		m_tree->recordMeasure();
+	}
+}
+
+void Widget::drawChildren() const
+{
+	for (auto& child : m_children)
 	{
-		polygon.draw(borderColor);
+		child->draw();
 	}
 }
 
+void Widget::drawBorder(const LayoutResults& layout) const
+{
+	BoxRenderer::DrawFrame(layout.rect(), layout.border, borderColor);
+}
+
 void Widget::drawContent(const LayoutResults& layout) const
 {
 	drawChildren();
@@ -129,15 +466,22 @@ void Widget::drawContent(const LayoutResults& layout) const
 
 void Widget::attachNode(facebook::yoga::Node& node)
 {
+	// 同じノードへ付け直す場合、スタイルも計測用の状態もmarkLayoutDirtyのたびに写し済み
+	if (m_node == &node)
+	{
+		return;
+	}
+
 	if (m_node)
 	{
 		detachNode();
 	}
 
 	m_node = &node;
-	m_node->setStyle(m_styleCache);
+	m_node->setStyle(*m_style);
 
 	onLayoutNodeAttach(*m_node);
+	onLayoutSnapshot();
 }
 
 void Widget::detachNode()
@@ -147,6 +491,98 @@ void Widget::detachNode()
 		return;
 	}
 
-	m_styleCache = m_node->getStyle();
+	if (usesNodeStyle())
+	{
+		pullNodeStyle();
+	}
 	m_node = nullptr;
+	m_tree = nullptr;
+	m_childrenChanged = false;
+	m_dirtyQueued = false;
+}
+
+bool Widget::usesNodeStyle() const
+{
+	return m_node && not (m_tree && m_tree->isAsyncLayout());
+}
+
+yoga::Style& Widget::ownStyle()
+{
+	if (not m_ownsStyle)
+	{
+		auto copy = std::make_shared<yoga::Style>(*m_style);
+		m_style = copy;
+		m_ownsStyle = true;
+		return *copy;
+	}
+
+	// 自分で作った複製なのでconstを外してよい
+	return const_cast<yoga::Style&>(*m_style);
+}
+
+void Widget::pullNodeStyle()
+{
+	if (m_node && m_node->getStyle() != *m_style)
+	{
+		ownStyle() = m_node->getStyle();
+	}
+}
+
+void Widget::adoptChildren()
+{
+	for (auto& child : m_children)
+	{
+		child->m_parent = this;
+	}
+}
+
+void Widget::recordChildrenChange()
+{
+	if (m_tree)
+	{
+		m_tree->recordChange(*this);
+	}
+
+	// 子の順序が変わるとセレクタの結果も変わる
+	if (m_nameIndex)
+	{
+		m_nameIndex->recordStructureChange();
+	}
+}
+
+Widget::~Widget()
+{
+	if (m_nameIndex)
+	{
+		m_nameIndex->unindexName(*this);
+	}
+
+	// 背景のレイアウトがこのWidgetを計測しているかもしれないので、終わるまで待つ
+	// removeChildで外したWidgetはレイアウトの間は生かされるが、ツリーごと破棄した場合や親と一緒に破棄された場合はここに来る
+	if (m_tree)
+	{
+		m_tree->waitForWorker();
+	}
+
+	// 破棄済みのWidgetをyoga::Nodeから辿らないようにする
+	// ノードの解放時には紐づけが切れているので、結果の番号はここで返す
+	if (m_node)
+	{
+		m_node->setContext(nullptr);
+	}
+
+	if (m_tree)
+	{
+		m_tree->releaseLayoutIndex(*this);
+	}
+
+	for (auto& child : m_children)
+	{
+		if (child->m_parent == this)
+		{
+			child->m_parent = nullptr;
+		}
+	}
+
+	WidgetSlotMap::Release(m_id);
 }
@@ -2,6 +2,11 @@
 #include <Siv3D.hpp>
 #include <yoga/style/Style.h>
 #include "LayoutResults.hpp"
+#include "LayoutResultsStore.hpp"
+#include "StyleClass.hpp"
+#include "WidgetName.hpp"
+#include "WidgetSlotMap.hpp"
+#include "SmallVector.hpp"
 
 class LayoutTree;
 namespace facebook::yoga { class Node; }
@@ -11,21 +16,30 @@ class Widget : public std::enable_shared_from_this<Widget>
 public:
 
 	Widget()
-		: m_id(RandomUint64())
+		: m_id(WidgetSlotMap::Allocate(this))
 	{ }
 
 	Widget(const Widget& other) = delete;
 
+	// idはムーブ先が引き継ぎ、ムーブ元は別のWidgetとして新しいidを得る
 	Widget(Widget&& other)
-		: children(std::move(other.children))
+		: m_children(std::move(other.m_children))
+		, m_id(other.m_id)
 	{
-		other.m_id = RandomInt64();
+		WidgetSlotMap::Rebind(m_id, this);
+		other.m_id = WidgetSlotMap::Allocate(&other);
+		adoptChildren();
 	}
 
 	Widget& operator=(Widget&& other)
 	{
-		children = std::move(other.children);
-		other.m_id = RandomInt64();
+		m_children = std::move(other.m_children);
+		WidgetSlotMap::Release(m_id);
+		m_id = other.m_id;
+		WidgetSlotMap::Rebind(m_id, this);
+		other.m_id = WidgetSlotMap::Allocate(&other);
+		adoptChildren();
+		return *this;
 	}
 
 	Widget& operator=(const Widget&) = delete;
@@ -36,34 +50,80 @@ public:
 
 public:
 
-	String name;
+	// 子は連続した領域に並べ、2つまではWidget自身の中に持つ
+	using Children = SmallVector<std::shared_ptr<Widget>, 2>;
 
 	ColorF borderColor = Palette::Black;
 
-	std::list<std::shared_ptr<Widget>> children;
+	// 子の構成はappendChild/insertChild/removeChild/moveChildでだけ変わり、LayoutTreeはその記録から組み直す
+	// 辿るときはfor (auto& child : children())のように参照で受け、shared_ptrを複製しない
+	const Children& children() const noexcept { return m_children; }
 
+	// 生きている間は他のWidgetと重ならず、WidgetSlotMap::FindやLayoutTree::findで引ける
 	int64 id() const { return m_id; }
 
+	// セレクタの型の名前
+	virtual StringView typeName() const { return U"Widget"; }
+
+	const String& name() const { return *m_name; }
+
+	// LayoutTreeに属している場合、名前の索引も更新する
+	void setName(StringView name);
+
+	Widget* parent() const { return m_parent; }
+
 	facebook::yoga::Node* layoutNode() const { return m_node; }
 
-	const Optional<LayoutResults>& layoutResults() const { return m_layoutResults; }
+	// 所属するLayoutTreeのLayoutResultsStoreから取り出す
+	Optional<LayoutResults> layoutResults() const;
+
+	// LayoutResultsStore上の番号
+	uint32 layoutIndex() const { return m_layoutIndex; }
 
+	// 共有のスタイルを使っている場合、書き換えられるよう自分専用に複製する
 	facebook::yoga::Style& style();
 
 	const facebook::yoga::Style& style() const;
 
 	void setStyle(const facebook::yoga::Style& style);
 
+	// 共有のスタイルを使う。yoga::Nodeへの反映以外で複製されない
+	void setStyleClass(StyleClass::Pointer style);
+
+	// 共有していないスタイルの場合はその複製を返す
+	StyleClass::Pointer styleClass() const;
+
 public:
 
+	// 自身と子孫からnameがvalueのWidgetを探す
+	// LayoutTreeに属している場合は名前の索引を引くので、一致したWidgetの数だけ手間がかかる
+	// 順序は索引の有無によらず、子孫を辿った順 (子が先、自身が後) の最初のもの。構成を変えた後の最初の呼び出しでは索引を並べ直すためツリーを辿る
 	std::shared_ptr<Widget> query(const StringView value);
 
 	Array<std::shared_ptr<Widget>> queryAll(const StringView value, size_t limit = Largest<size_t>);
 
+	// resultの末尾に追加する。毎フレーム同じresultを使い回せば確保は起きない
 	void queryAll(const StringView value, Array<std::shared_ptr<Widget>>& result, size_t limit = Largest<size_t>);
 
+	// 自身と子孫からセレクタ (Selector参照) に一致するWidgetをresultの末尾に追加する
+	// LayoutTreeに属している場合はツリーのキャッシュを使い、構成も名前も変わっていなければ辿らない
+	// 解析できないセレクタはfalseを返す
+	bool selectAll(const StringView selector, Array<std::shared_ptr<Widget>>& result);
+
+	void appendChild(std::shared_ptr<Widget> child);
+
+	void insertChild(size_t index, std::shared_ptr<Widget> child);
+
+	bool removeChild(const std::shared_ptr<Widget>& child);
+
+	bool moveChild(const std::shared_ptr<Widget>& child, size_t index);
+
+	// 画面に見えている範囲 (現在の変換とシザー矩形から求める) の外にある子孫は辿らない
+	// overflowがvisibleでないWidgetは、内容と子を枠の内側にシザー矩形で切り抜いて描く
 	void draw();
 
+	// 大きさが固定された祖先があれば、レイアウトし直すのはそこから下だけになる
+	// LayoutTree::Batchの中では抜けるときにまとめて反映される
 	void markLayoutDirty();
 
 	virtual bool allowChildren() const { return true; }
@@ -78,23 +138,78 @@ protected:
 
 	virtual void onLayoutNodeAttach(facebook::yoga::Node&) { }
 
+	// 計測関数から呼び、LayoutTreeのフレームごとの計測回数に数える
+	void recordMeasure() const;
+
+	// 計測関数が使う状態をレイアウト用に写す
+	// 非同期のレイアウト中は呼ばれないので、計測関数はここで写した状態だけを読む
+	virtual void onLayoutSnapshot() { }
+
 private:
 
 	friend LayoutTree;
 
-	intptr_t m_id;
+	friend class WidgetTreeLoader;
+
+	friend class Selector;
+
+	Children m_children;
+
+	int64 m_id;
+
+	Widget* m_parent = nullptr;
+
+	LayoutTree* m_tree = nullptr;
+
+	WidgetName::Reference m_name;
+
+	// 名前の索引に載せているLayoutTree。constructの前でも、子として追加された時点で載る
+	LayoutTree* m_nameIndex = nullptr;
+
+	// 索引の中の位置
+	uint32 m_nameSlot = 0;
+
+	// 名前の索引を並べる、ツリーを辿った順の番号 (子が先、自身が後)。自身と子孫はm_subtreeOrderからm_treeOrderまで
+	uint32 m_treeOrder = 0;
+
+	uint32 m_subtreeOrder = 0;
+
+	bool m_childrenChanged = false;
+
+	// LayoutTreeのバッチや非同期のレイアウトの終了を待って汚される
+	bool m_dirtyQueued = false;
 
 	facebook::yoga::Node* m_node = nullptr;
 
-	facebook::yoga::Style m_styleCache;
+	StyleClass::Pointer m_style = StyleClass::Default();
 
-	Optional<LayoutResults> m_layoutResults;
+	// m_styleがこのWidget専用の複製で、書き換えてよい
+	bool m_ownsStyle = false;
+
+	uint32 m_layoutIndex = LayoutResultsStore::InvalidIndex;
 
 	void attachNode(facebook::yoga::Node& node);
 
 	void detachNode();
 
+	// 同期的にレイアウトするLayoutTreeに付いている間はyoga::Nodeのスタイルを正とする
+	// それ以外ではm_styleが正で、yoga::Nodeへは付けるときと汚すときに写す
+	bool usesNodeStyle() const;
+
+	facebook::yoga::Style& ownStyle();
+
+	// yoga::Node側で書き換えられたスタイルをm_styleへ戻す
+	void pullNodeStyle();
+
+	void adoptChildren();
+
+	void queryAll(WidgetName::Pointer name, Array<std::shared_ptr<Widget>>& result, size_t limit);
+
+	bool isDescendantOf(const Widget& ancestor) const;
+
+	void recordChildrenChange();
+
 public:
 
-	virtual ~Widget() = default;
+	virtual ~Widget();
 };
@@ -0,0 +1,113 @@
+﻿#include "WidgetName.hpp"
+
+namespace
+{
+	struct Entry
+	{
+		const String value;
+
+		size_t references = 0;
+	};
+
+	struct Registry
+	{
+		std::mutex mutex;
+
+		// キーは値のStringを指す
+		HashTable<StringView, std::unique_ptr<Entry>> names;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+}
+
+WidgetName::Pointer WidgetName::Empty()
+{
+	static const String empty;
+	return &empty;
+}
+
+WidgetName::Reference WidgetName::Intern(StringView name)
+{
+	if (name.isEmpty())
+	{
+		return Reference{};
+	}
+
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	auto it = registry.names.find(name);
+	if (it == registry.names.end())
+	{
+		auto entry = std::make_unique<Entry>(String{ name });
+		const StringView key = entry->value;
+		it = registry.names.emplace(key, std::move(entry)).first;
+	}
+
+	it->second->references++;
+	return Reference{ &it->second->value };
+}
+
+WidgetName::Pointer WidgetName::Find(StringView name)
+{
+	if (name.isEmpty())
+	{
+		return Empty();
+	}
+
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	if (auto it = registry.names.find(name);
+		it != registry.names.end())
+	{
+		return &it->second->value;
+	}
+
+	return nullptr;
+}
+
+size_t WidgetName::Count()
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+	return registry.names.size();
+}
+
+void WidgetName::Retain(Pointer pointer)
+{
+	if (pointer == Empty())
+	{
+		return;
+	}
+
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	auto it = registry.names.find(StringView{ *pointer });
+	assert(it != registry.names.end());
+	it->second->references++;
+}
+
+void WidgetName::Release(Pointer pointer)
+{
+	if (pointer == Empty())
+	{
+		return;
+	}
+
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	auto it = registry.names.find(StringView{ *pointer });
+	assert(it != registry.names.end());
+
+	if (--it->second->references == 0)
+	{
+		registry.names.erase(it);
+	}
+}
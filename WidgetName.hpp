@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+
+// Widgetの名前を集約する。同じ名前は同じStringを指すので、ポインタで比べられる
+// 登録した名前は参照の数を数え、Referenceがなくなった時点で解放する
+class WidgetName
+{
+public:
+
+	using Pointer = const String*;
+
+	// 登録を保つ参照。空の名前は数えない
+	class Reference
+	{
+	public:
+
+		Reference() noexcept
+			: m_pointer(Empty())
+		{ }
+
+		Reference(const Reference& other)
+			: m_pointer(other.m_pointer)
+		{
+			Retain(m_pointer);
+		}
+
+		Reference(Reference&& other) noexcept
+			: m_pointer(std::exchange(other.m_pointer, Empty()))
+		{ }
+
+		Reference& operator=(const Reference& other)
+		{
+			Retain(other.m_pointer);
+			Release(m_pointer);
+			m_pointer = other.m_pointer;
+			return *this;
+		}
+
+		Reference& operator=(Reference&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Release(m_pointer);
+				m_pointer = std::exchange(other.m_pointer, Empty());
+			}
+			return *this;
+		}
+
+		~Reference()
+		{
+			Release(m_pointer);
+		}
+
+		Pointer get() const noexcept { return m_pointer; }
+
+		const String& operator*() const noexcept { return *m_pointer; }
+
+		bool operator==(Pointer other) const noexcept { return m_pointer == other; }
+
+	private:
+
+		friend class WidgetName;
+
+		// 参照を数え終えたポインタを受け取る
+		explicit Reference(Pointer pointer) noexcept
+			: m_pointer(pointer)
+		{ }
+
+		Pointer m_pointer;
+	};
+
+	// 空の名前
+	static Pointer Empty();
+
+	// 登録済みであればそれを、なければ登録して参照を返す
+	static Reference Intern(StringView name);
+
+	// 登録済みの名前。なければnullptr (その名前のWidgetは存在しない)
+	static Pointer Find(StringView name);
+
+	// 登録されている名前の数
+	static size_t Count();
+
+private:
+
+	static void Retain(Pointer pointer);
+
+	static void Release(Pointer pointer);
+};
@@ -0,0 +1,57 @@
+﻿#include "WidgetName.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "Widget.hpp"
+#include "Selector.hpp"
+
+namespace
+{
+	// 参照がなくなった名前は登録から外れる
+	const UnitTest::Registration WidgetNameTest{ U"WidgetName", [](Array<String>& failures)
+		{
+			const size_t before = WidgetName::Count();
+
+			{
+				auto a = std::make_shared<Widget>();
+				auto b = std::make_shared<Widget>();
+				a->setName(U"widget-name-test");
+				b->setName(U"widget-name-test");
+
+				if (&a->name() != &b->name() || WidgetName::Count() != before + 1)
+				{
+					failures << U"the same name was registered twice";
+				}
+
+				// 名前を変えると、前の名前の参照は1つ減る
+				a->setName(U"");
+				if (WidgetName::Find(U"widget-name-test") != &b->name())
+				{
+					failures << U"a name still in use was released";
+				}
+			}
+
+			if (WidgetName::Find(U"widget-name-test") || WidgetName::Count() != before)
+			{
+				failures << U"a name was kept after its widgets were destroyed";
+			}
+
+			// セレクタの名前はSelectorが残る間だけ登録される
+			{
+				const auto selector = Selector::Compile(U"Widget > #selector-name-test");
+
+				if (not selector || not WidgetName::Find(U"selector-name-test"))
+				{
+					failures << U"a compiled selector did not keep its name";
+				}
+			}
+
+			if (WidgetName::Find(U"selector-name-test") || WidgetName::Count() != before)
+			{
+				failures << U"a selector name was kept after the selector was destroyed";
+			}
+		} };
+}
+
+#endif
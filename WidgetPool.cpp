@@ -0,0 +1,235 @@
+﻿#include "WidgetPool.hpp"
+#include "Widget.hpp"
+#include "Label.hpp"
+
+namespace
+{
+	// これより小さい文字列はヒープを使わないので引き取らない
+	const size_t InlineStringCapacity = String{}.capacity();
+}
+
+// 1つの型の領域を、倍々に大きくなるスラブから切り出す
+class WidgetPool::TypePool
+{
+public:
+
+	TypePool(size_t size, size_t alignment)
+		: m_alignment(Max(alignment, alignof(void*)))
+		, m_slotSize((Max(size, sizeof(void*)) + m_alignment - 1) / m_alignment * m_alignment) { }
+
+	TypePool(const TypePool&) = delete;
+
+	TypePool& operator=(const TypePool&) = delete;
+
+	~TypePool()
+	{
+		releaseSlabs();
+	}
+
+	void* allocate()
+	{
+		if (not m_free)
+		{
+			grow();
+		}
+
+		void* slot = m_free;
+		m_free = *static_cast<void**>(slot);
+		m_live++;
+		return slot;
+	}
+
+	// 空いた領域は未使用の連結リストの先頭に積み、次の確保ですぐに使う
+	void deallocate(void* slot)
+	{
+		*static_cast<void**>(slot) = m_free;
+		m_free = slot;
+		m_live--;
+	}
+
+	size_t live() const { return m_live; }
+
+	size_t capacity() const { return m_capacity; }
+
+	size_t slabs() const { return m_slabs.size(); }
+
+	size_t reservedBytes() const { return m_capacity * m_slotSize; }
+
+	// 使用中の要素がなければ全てのスラブを解放する
+	size_t trim()
+	{
+		if (m_live != 0)
+		{
+			return 0;
+		}
+
+		const size_t released = m_capacity;
+		releaseSlabs();
+		return released;
+	}
+
+private:
+
+	struct Slab
+	{
+		std::byte* data;
+
+		size_t count;
+	};
+
+	const size_t m_alignment;
+
+	const size_t m_slotSize;
+
+	Array<Slab> m_slabs;
+
+	void* m_free = nullptr;
+
+	size_t m_live = 0;
+
+	size_t m_capacity = 0;
+
+	void grow()
+	{
+		const size_t count = m_slabs.empty() ? DefaultSlabSize : Min(m_slabs.back().count * 2, MaxSlabSize);
+		auto data = static_cast<std::byte*>(::operator new(count * m_slotSize, std::align_val_t{ m_alignment }));
+
+		// 先頭から順に使われるよう逆順に積む
+		for (size_t i = count; i > 0; i--)
+		{
+			void* slot = data + (i - 1) * m_slotSize;
+			*static_cast<void**>(slot) = m_free;
+			m_free = slot;
+		}
+
+		m_slabs.push_back({ data, count });
+		m_capacity += count;
+	}
+
+	void releaseSlabs()
+	{
+		for (auto& slab : m_slabs)
+		{
+			::operator delete(slab.data, std::align_val_t{ m_alignment });
+		}
+
+		m_slabs.clear();
+		m_free = nullptr;
+		m_capacity = 0;
+	}
+};
+
+WidgetPool::WidgetPool() = default;
+
+WidgetPool::~WidgetPool()
+{
+	assert(m_stats.live == 0);
+}
+
+void WidgetPool::trim()
+{
+	std::lock_guard lock{ m_mutex };
+
+	for (auto& [type, pool] : m_types)
+	{
+		pool->trim();
+	}
+
+	m_buffers.clear();
+	m_buffers.shrink_to_fit();
+}
+
+WidgetPool::Stats WidgetPool::stats() const
+{
+	std::lock_guard lock{ m_mutex };
+
+	Stats stats = m_stats;
+	for (auto& [type, pool] : m_types)
+	{
+		stats.pooled += pool->capacity() - pool->live();
+		stats.slabs += pool->slabs();
+		stats.reservedBytes += pool->reservedBytes();
+	}
+	stats.pooledBuffers = m_buffers.size();
+	return stats;
+}
+
+void* WidgetPool::allocate(const std::type_info& type, size_t size, size_t alignment)
+{
+	std::lock_guard lock{ m_mutex };
+
+	auto& pool = m_types[std::type_index{ type }];
+	if (not pool)
+	{
+		pool = std::make_unique<TypePool>(size, alignment);
+	}
+
+	void* slot = pool->allocate();
+
+	m_stats.live++;
+	m_stats.peak = Max(m_stats.peak, m_stats.live);
+
+	return slot;
+}
+
+void WidgetPool::deallocate(const std::type_info& type, void* pointer)
+{
+	std::lock_guard lock{ m_mutex };
+
+	auto it = m_types.find(std::type_index{ type });
+	assert(it != m_types.end());
+
+	it->second->deallocate(pointer);
+	m_stats.live--;
+}
+
+void WidgetPool::adoptBuffers(Widget& widget)
+{
+	std::lock_guard lock{ m_mutex };
+
+	// 名前はWidgetNameに集約されているので、バッファを持つのはLabelの文字列だけ
+	if (auto label = dynamic_cast<Label*>(&widget);
+		label && label->m_text.isEmpty())
+	{
+		takeBuffer(label->m_text);
+	}
+}
+
+void WidgetPool::recycleBuffers(Widget& widget)
+{
+	std::lock_guard lock{ m_mutex };
+
+	if (auto label = dynamic_cast<Label*>(&widget))
+	{
+		giveBuffer(label->m_text);
+	}
+}
+
+bool WidgetPool::takeBuffer(String& buffer)
+{
+	if (m_buffers.empty())
+	{
+		return false;
+	}
+
+	buffer = std::move(m_buffers.back());
+	m_buffers.pop_back();
+	m_stats.recycledBuffers++;
+	return true;
+}
+
+bool WidgetPool::giveBuffer(String& buffer)
+{
+	const size_t capacity = buffer.capacity();
+
+	if (m_buffers.size() >= MaxPooledBuffers ||
+		capacity <= InlineStringCapacity ||
+		capacity > MaxBufferCapacity)
+	{
+		return false;
+	}
+
+	buffer.clear();
+	m_buffers.push_back(std::move(buffer));
+	return true;
+}
@@ -0,0 +1,167 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include <typeindex>
+
+class Widget;
+
+// Widgetとその派生クラスを型ごとのスラブにまとめて確保するアロケータ
+// 破棄されたWidgetの領域とLabelの文字列のバッファは次に作るWidgetで使い回す
+// Widgetはプールへの参照を持つので、プールより長く生きてもよい
+class WidgetPool : public std::enable_shared_from_this<WidgetPool>
+{
+public:
+
+	struct Stats
+	{
+		// 使用中のWidgetの数
+		size_t live = 0;
+
+		// 確保済みで未使用の領域の数
+		size_t pooled = 0;
+
+		// liveの最大値
+		size_t peak = 0;
+
+		size_t slabs = 0;
+
+		size_t reservedBytes = 0;
+
+		// 使い回すために保持している文字列のバッファの数
+		size_t pooledBuffers = 0;
+
+		// 使い回された文字列のバッファの数
+		size_t recycledBuffers = 0;
+	};
+
+	// 型ごとの最初のスラブの要素数。足りなくなるたびに倍にする
+	static constexpr size_t DefaultSlabSize = 64;
+
+	static constexpr size_t MaxSlabSize = 16384;
+
+	// 保持する文字列のバッファの数と、1つあたりの最大の容量
+	static constexpr size_t MaxPooledBuffers = 4096;
+
+	static constexpr size_t MaxBufferCapacity = 256;
+
+	template <class Type>
+	class Allocator;
+
+	WidgetPool();
+
+	WidgetPool(const WidgetPool&) = delete;
+
+	WidgetPool& operator=(const WidgetPool&) = delete;
+
+	~WidgetPool();
+
+public:
+
+	// shared_ptrで管理されたプールからのみ呼べる
+	template <class WidgetType, class... Args>
+	std::shared_ptr<WidgetType> create(Args&&... args)
+	{
+		return std::allocate_shared<WidgetType>(Allocator<WidgetType>{ shared_from_this() }, std::forward<Args>(args)...);
+	}
+
+	// poolがnullptrの場合はstd::make_sharedで作る
+	template <class WidgetType, class... Args>
+	static std::shared_ptr<WidgetType> Create(WidgetPool* pool, Args&&... args)
+	{
+		if (pool)
+		{
+			return pool->create<WidgetType>(std::forward<Args>(args)...);
+		}
+
+		return std::make_shared<WidgetType>(std::forward<Args>(args)...);
+	}
+
+	// 使用中の要素がない型のスラブと、保持している文字列のバッファを解放する
+	void trim();
+
+	Stats stats() const;
+
+private:
+
+	class TypePool;
+
+	HashTable<std::type_index, std::unique_ptr<TypePool>> m_types;
+
+	Array<String> m_buffers;
+
+	Stats m_stats;
+
+	mutable std::mutex m_mutex;
+
+	void* allocate(const std::type_info& type, size_t size, size_t alignment);
+
+	void deallocate(const std::type_info& type, void* pointer);
+
+	// 作ったWidgetへ保持しているバッファを渡す
+	void adoptBuffers(Widget& widget);
+
+	// 破棄するWidgetのバッファを引き取る
+	void recycleBuffers(Widget& widget);
+
+	bool takeBuffer(String& buffer);
+
+	bool giveBuffer(String& buffer);
+};
+
+// std::allocate_sharedに渡し、Widgetと参照カウントを1つの領域に置く
+template <class Type>
+class WidgetPool::Allocator
+{
+public:
+
+	using value_type = Type;
+
+	explicit Allocator(std::shared_ptr<WidgetPool> pool) noexcept
+		: m_pool(std::move(pool)) { }
+
+	template <class Other>
+	Allocator(const Allocator<Other>& other) noexcept
+		: m_pool(other.m_pool) { }
+
+	Type* allocate(size_t n)
+	{
+		assert(n == 1);
+		return static_cast<Type*>(m_pool->allocate(typeid(Type), sizeof(Type) * n, alignof(Type)));
+	}
+
+	void deallocate(Type* pointer, size_t)
+	{
+		m_pool->deallocate(typeid(Type), pointer);
+	}
+
+	template <class Object, class... Args>
+	void construct(Object* pointer, Args&&... args)
+	{
+		new (static_cast<void*>(pointer)) Object(std::forward<Args>(args)...);
+
+		if constexpr (std::is_base_of_v<Widget, Object>)
+		{
+			m_pool->adoptBuffers(*pointer);
+		}
+	}
+
+	template <class Object>
+	void destroy(Object* pointer)
+	{
+		if constexpr (std::is_base_of_v<Widget, Object>)
+		{
+			m_pool->recycleBuffers(*pointer);
+		}
+
+		std::destroy_at(pointer);
+	}
+
+	template <class Other>
+	bool operator==(const Allocator<Other>& other) const noexcept { return m_pool == other.m_pool; }
+
+private:
+
+	template <class Other>
+	friend class Allocator;
+
+	std::shared_ptr<WidgetPool> m_pool;
+};
@@ -0,0 +1,113 @@
+﻿#include "WidgetSlotMap.hpp"
+
+namespace
+{
+	struct Slot
+	{
+		Widget* widget = nullptr;
+
+		uint32 generation = 0;
+	};
+
+	struct Registry
+	{
+		std::mutex mutex;
+
+		Array<Slot> slots;
+
+		// 空いている番号。最後に空いたものから使う
+		Array<uint32> freeIndices;
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	constexpr int64 MakeId(uint32 index, uint32 generation)
+	{
+		return static_cast<int64>((static_cast<uint64>(generation) << 32) | index);
+	}
+}
+
+int64 WidgetSlotMap::Allocate(Widget* widget)
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	uint32 index;
+	if (registry.freeIndices.empty())
+	{
+		index = static_cast<uint32>(registry.slots.size());
+		registry.slots.emplace_back();
+	}
+	else
+	{
+		index = registry.freeIndices.back();
+		registry.freeIndices.pop_back();
+	}
+
+	auto& slot = registry.slots[index];
+	slot.widget = widget;
+
+	// 世代0はInvalidIdと重なるので飛ばす
+	if (++slot.generation == 0)
+	{
+		slot.generation = 1;
+	}
+
+	return MakeId(index, slot.generation);
+}
+
+void WidgetSlotMap::Release(int64 id)
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	const uint32 index = Index(id);
+	assert(index < registry.slots.size() && registry.slots[index].generation == Generation(id));
+
+	registry.slots[index].widget = nullptr;
+	registry.freeIndices.push_back(index);
+}
+
+void WidgetSlotMap::Rebind(int64 id, Widget* widget)
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	const uint32 index = Index(id);
+	assert(index < registry.slots.size() && registry.slots[index].generation == Generation(id));
+
+	registry.slots[index].widget = widget;
+}
+
+Widget* WidgetSlotMap::Find(int64 id)
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+
+	const uint32 index = Index(id);
+	if (index >= registry.slots.size())
+	{
+		return nullptr;
+	}
+
+	const auto& slot = registry.slots[index];
+	return slot.generation == Generation(id) ? slot.widget : nullptr;
+}
+
+size_t WidgetSlotMap::Count()
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+	return registry.slots.size() - registry.freeIndices.size();
+}
+
+size_t WidgetSlotMap::Capacity()
+{
+	auto& registry = GetRegistry();
+	std::lock_guard lock{ registry.mutex };
+	return registry.slots.size();
+}
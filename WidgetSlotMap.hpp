@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+
+class Widget;
+
+// 生きているWidgetをidからO(1)で引く表
+// idは下位32ビットが番号、上位32ビットが世代。番号は破棄されたWidgetのものを詰めて使い回し、
+// そのたびに世代を進めるので、破棄済みのWidgetのidは同じ番号の新しいWidgetと区別できる
+class WidgetSlotMap
+{
+public:
+
+	// どのWidgetのidにもならない
+	static constexpr int64 InvalidId = 0;
+
+	static constexpr uint32 Index(int64 id) noexcept { return static_cast<uint32>(id); }
+
+	static constexpr uint32 Generation(int64 id) noexcept { return static_cast<uint32>(static_cast<uint64>(id) >> 32); }
+
+	// 空いている番号を割り当て、その番号の世代を進める (破棄では世代を変えない)
+	static int64 Allocate(Widget* widget);
+
+	// 番号を空け、以降Findでidを引けなくする
+	static void Release(int64 id);
+
+	// ムーブしたWidgetへidを引き継ぐ
+	static void Rebind(int64 id, Widget* widget);
+
+	// 破棄済み、または世代の違うidはnullptr
+	static Widget* Find(int64 id);
+
+	// 生きているWidgetの数
+	static size_t Count();
+
+	// 割り当てたことのある番号の数
+	static size_t Capacity();
+};
@@ -0,0 +1,68 @@
+﻿#include "WidgetSlotMap.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+
+namespace
+{
+	constexpr size_t NodeCount = 2'000;
+
+	void CollectIds(const Widget& widget, Array<std::pair<int64, const Widget*>>& result)
+	{
+		result.emplace_back(widget.id(), &widget);
+
+		for (auto& child : widget.children())
+		{
+			CollectIds(*child, result);
+		}
+	}
+
+	const UnitTest::Registration WidgetSlotMapTest{ U"WidgetSlotMap", [](Array<String>& failures)
+		{
+			const auto root = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Balanced, NodeCount);
+			LayoutTree tree{ root };
+
+			Array<std::pair<int64, const Widget*>> ids;
+			CollectIds(*root, ids);
+
+			size_t wrong = 0;
+			for (auto [id, widget] : ids)
+			{
+				wrong += (tree.find(id) != widget) || (WidgetSlotMap::Find(id) != widget);
+			}
+
+			if (wrong)
+			{
+				failures << U"{} live widgets were not resolved by their id"_fmt(wrong);
+			}
+
+			// 取り除いた部分木のidは、番号が新しいWidgetに使い回されても引けない
+			Array<std::pair<int64, const Widget*>> removed;
+			while (not root->children().empty())
+			{
+				auto child = root->children().back();
+				CollectIds(*child, removed);
+				root->removeChild(child);
+			}
+			tree.construct(root);
+
+			const auto replacement = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Balanced, NodeCount);
+			root->appendChild(replacement);
+			tree.construct(root);
+
+			size_t stale = 0;
+			for (auto [id, widget] : removed)
+			{
+				stale += (tree.find(id) != nullptr) || (WidgetSlotMap::Find(id) != nullptr);
+			}
+
+			if (stale)
+			{
+				failures << U"{} removed widgets were still resolved by id"_fmt(stale);
+			}
+		} };
+}
+
+#endif
@@ -0,0 +1,563 @@
+﻿#include "WidgetSnapshot.hpp"
+#include "Label.hpp"
+#include "BoxRenderer.hpp"
+
+using namespace facebook;
+
+namespace
+{
+	constexpr std::array<char, 4> Magic{ 'S', 'Y', 'W', 'S' };
+
+	constexpr std::array Edges{
+		yoga::Edge::Left, yoga::Edge::Top, yoga::Edge::Right, yoga::Edge::Bottom,
+		yoga::Edge::Start, yoga::Edge::End, yoga::Edge::Horizontal, yoga::Edge::Vertical, yoga::Edge::All,
+	};
+
+	constexpr std::array Gutters{ yoga::Gutter::Column, yoga::Gutter::Row, yoga::Gutter::All };
+
+	constexpr std::array Dimensions{ yoga::Dimension::Width, yoga::Dimension::Height };
+
+	struct LengthRecord
+	{
+		float value;
+
+		uint32 unit;
+	};
+
+	LengthRecord EncodeLength(yoga::StyleLength length)
+	{
+		return{ length.value().unwrap(), static_cast<uint32>(length.unit()) };
+	}
+
+	yoga::StyleLength DecodeLength(const LengthRecord& record)
+	{
+		switch (static_cast<yoga::Unit>(record.unit))
+		{
+		case yoga::Unit::Point: return yoga::StyleLength::points(record.value);
+		case yoga::Unit::Percent: return yoga::StyleLength::percent(record.value);
+		case yoga::Unit::Auto: return yoga::StyleLength::ofAuto();
+		default: return yoga::StyleLength::undefined();
+		}
+	}
+
+	std::array<float, 4> EncodeColor(const ColorF& color)
+	{
+		return{ static_cast<float>(color.r), static_cast<float>(color.g), static_cast<float>(color.b), static_cast<float>(color.a) };
+	}
+
+	ColorF DecodeColor(const std::array<float, 4>& color)
+	{
+		return{ color[0], color[1], color[2], color[3] };
+	}
+}
+
+struct WidgetSnapshot::Header
+{
+	std::array<char, 4> magic;
+
+	uint32 version;
+
+	float width;
+
+	float height;
+
+	uint32 nodeCount;
+
+	uint32 styleCount;
+
+	// 文字数 (char32単位)
+	uint32 stringLength;
+
+	uint32 nodesOffset;
+
+	uint32 stylesOffset;
+
+	uint32 stringsOffset;
+};
+
+struct WidgetSnapshot::NodeRecord
+{
+	WidgetType type;
+
+	bool hasLayout;
+
+	std::array<uint8, 2> reserved;
+
+	uint32 childCount;
+
+	uint32 styleIndex;
+
+	uint32 nameOffset;
+
+	uint32 nameLength;
+
+	uint32 textOffset;
+
+	uint32 textLength;
+
+	std::array<float, 4> borderColor;
+
+	std::array<float, 4> color;
+
+	// offset (x, y), localRect (x, y, w, h), margin, border, padding (各left, top, right, bottom) の順
+	std::array<float, 18> layout;
+};
+
+struct WidgetSnapshot::StyleRecord
+{
+	// direction, flexDirection, justifyContent, alignContent, alignItems, alignSelf, positionType, flexWrap, overflow, display
+	std::array<uint8, 12> enums;
+
+	// flex, flexGrow, flexShrink, aspectRatio (未定義はNaN)
+	std::array<float, 4> floats;
+
+	LengthRecord flexBasis;
+
+	std::array<LengthRecord, Dimensions.size()> dimension, minDimension, maxDimension;
+
+	std::array<LengthRecord, Edges.size()> margin, position, padding, border;
+
+	std::array<LengthRecord, Gutters.size()> gap;
+
+	static StyleRecord Encode(const yoga::Style& style)
+	{
+		StyleRecord record{ };
+
+		record.enums = {
+			static_cast<uint8>(style.direction()),
+			static_cast<uint8>(style.flexDirection()),
+			static_cast<uint8>(style.justifyContent()),
+			static_cast<uint8>(style.alignContent()),
+			static_cast<uint8>(style.alignItems()),
+			static_cast<uint8>(style.alignSelf()),
+			static_cast<uint8>(style.positionType()),
+			static_cast<uint8>(style.flexWrap()),
+			static_cast<uint8>(style.overflow()),
+			static_cast<uint8>(style.display()),
+		};
+
+		record.floats = {
+			style.flex().unwrap(),
+			style.flexGrow().unwrap(),
+			style.flexShrink().unwrap(),
+			style.aspectRatio().unwrap(),
+		};
+
+		record.flexBasis = EncodeLength(style.flexBasis());
+
+		for (size_t i = 0; i < Dimensions.size(); i++)
+		{
+			record.dimension[i] = EncodeLength(style.dimension(Dimensions[i]));
+			record.minDimension[i] = EncodeLength(style.minDimension(Dimensions[i]));
+			record.maxDimension[i] = EncodeLength(style.maxDimension(Dimensions[i]));
+		}
+
+		for (size_t i = 0; i < Edges.size(); i++)
+		{
+			record.margin[i] = EncodeLength(style.margin(Edges[i]));
+			record.position[i] = EncodeLength(style.position(Edges[i]));
+			record.padding[i] = EncodeLength(style.padding(Edges[i]));
+			record.border[i] = EncodeLength(style.border(Edges[i]));
+		}
+
+		for (size_t i = 0; i < Gutters.size(); i++)
+		{
+			record.gap[i] = EncodeLength(style.gap(Gutters[i]));
+		}
+
+		return record;
+	}
+
+	yoga::Style decode() const
+	{
+		yoga::Style style;
+
+		style.setDirection(static_cast<yoga::Direction>(enums[0]));
+		style.setFlexDirection(static_cast<yoga::FlexDirection>(enums[1]));
+		style.setJustifyContent(static_cast<yoga::Justify>(enums[2]));
+		style.setAlignContent(static_cast<yoga::Align>(enums[3]));
+		style.setAlignItems(static_cast<yoga::Align>(enums[4]));
+		style.setAlignSelf(static_cast<yoga::Align>(enums[5]));
+		style.setPositionType(static_cast<yoga::PositionType>(enums[6]));
+		style.setFlexWrap(static_cast<yoga::Wrap>(enums[7]));
+		style.setOverflow(static_cast<yoga::Overflow>(enums[8]));
+		style.setDisplay(static_cast<yoga::Display>(enums[9]));
+
+		style.setFlex(yoga::FloatOptional{ floats[0] });
+		style.setFlexGrow(yoga::FloatOptional{ floats[1] });
+		style.setFlexShrink(yoga::FloatOptional{ floats[2] });
+		style.setAspectRatio(yoga::FloatOptional{ floats[3] });
+
+		style.setFlexBasis(DecodeLength(flexBasis));
+
+		for (size_t i = 0; i < Dimensions.size(); i++)
+		{
+			style.setDimension(Dimensions[i], DecodeLength(dimension[i]));
+			style.setMinDimension(Dimensions[i], DecodeLength(minDimension[i]));
+			style.setMaxDimension(Dimensions[i], DecodeLength(maxDimension[i]));
+		}
+
+		for (size_t i = 0; i < Edges.size(); i++)
+		{
+			style.setMargin(Edges[i], DecodeLength(margin[i]));
+			style.setPosition(Edges[i], DecodeLength(position[i]));
+			style.setPadding(Edges[i], DecodeLength(padding[i]));
+			style.setBorder(Edges[i], DecodeLength(border[i]));
+		}
+
+		for (size_t i = 0; i < Gutters.size(); i++)
+		{
+			style.setGap(Gutters[i], DecodeLength(gap[i]));
+		}
+
+		return style;
+	}
+};
+
+WidgetSnapshot::WidgetSnapshot(FilePathView path)
+{
+	open(path);
+}
+
+bool WidgetSnapshot::Save(FilePathView path, const Widget& root, SizeF layoutSize)
+{
+	Array<NodeRecord> nodes;
+	Array<StyleRecord> styles;
+	Array<char32> strings;
+
+	// 内容の同じスタイルはStyleClassで同じポインタになる
+	// 書き出し終わるまでポインタが使い回されないよう、styleClassesで保持する
+	HashTable<const yoga::Style*, uint32> styleIndices;
+	Array<StyleClass::Pointer> styleClasses;
+
+	auto addString = [&](StringView s, uint32& offset, uint32& length)
+		{
+			offset = static_cast<uint32>(strings.size());
+			length = static_cast<uint32>(s.size());
+			strings.insert(strings.end(), s.begin(), s.end());
+		};
+
+	Array<const Widget*> stack{ &root };
+
+	while (not stack.empty())
+	{
+		const Widget* widget = stack.back();
+		stack.pop_back();
+
+		NodeRecord record{ };
+		record.childCount = static_cast<uint32>(widget->children().size());
+		record.borderColor = EncodeColor(widget->borderColor);
+		addString(widget->name(), record.nameOffset, record.nameLength);
+
+		if (auto label = dynamic_cast<const Label*>(widget))
+		{
+			record.type = WidgetType::Label;
+			record.color = EncodeColor(label->color());
+			addString(label->text(), record.textOffset, record.textLength);
+		}
+		else
+		{
+			record.type = WidgetType::Widget;
+		}
+
+		auto style = StyleClass::Intern(widget->style());
+		auto [it, inserted] = styleIndices.emplace(style.get(), static_cast<uint32>(styles.size()));
+		if (inserted)
+		{
+			styles.push_back(StyleRecord::Encode(*style));
+			styleClasses.push_back(std::move(style));
+		}
+		record.styleIndex = it->second;
+
+		if (auto layout = widget->layoutResults())
+		{
+			const RectF& r = layout->localRect;
+			record.hasLayout = true;
+			record.layout = {
+				static_cast<float>(layout->offset.x), static_cast<float>(layout->offset.y),
+				static_cast<float>(r.x), static_cast<float>(r.y), static_cast<float>(r.w), static_cast<float>(r.h),
+				static_cast<float>(layout->margin.left), static_cast<float>(layout->margin.top),
+				static_cast<float>(layout->margin.right), static_cast<float>(layout->margin.bottom),
+				static_cast<float>(layout->border.left), static_cast<float>(layout->border.top),
+				static_cast<float>(layout->border.right), static_cast<float>(layout->border.bottom),
+				static_cast<float>(layout->padding.left), static_cast<float>(layout->padding.top),
+				static_cast<float>(layout->padding.right), static_cast<float>(layout->padding.bottom),
+			};
+		}
+
+		nodes.push_back(record);
+
+		// 先行順で書き出すため、逆順に積む
+		for (auto it = widget->children().rbegin(); it != widget->children().rend(); ++it)
+		{
+			stack.push_back(it->get());
+		}
+	}
+
+	Header header{
+		.magic = Magic,
+		.version = FormatVersion,
+		.width = static_cast<float>(layoutSize.x),
+		.height = static_cast<float>(layoutSize.y),
+		.nodeCount = static_cast<uint32>(nodes.size()),
+		.styleCount = static_cast<uint32>(styles.size()),
+		.stringLength = static_cast<uint32>(strings.size()),
+	};
+	header.nodesOffset = sizeof(Header);
+	header.stylesOffset = header.nodesOffset + static_cast<uint32>(nodes.size_bytes());
+	header.stringsOffset = header.stylesOffset + static_cast<uint32>(styles.size_bytes());
+
+	BinaryWriter writer{ path };
+	if (not writer)
+	{
+		return false;
+	}
+
+	writer.write(&header, sizeof(header));
+	writer.write(nodes.data(), nodes.size_bytes());
+	writer.write(styles.data(), styles.size_bytes());
+	writer.write(strings.data(), strings.size_bytes());
+
+	return true;
+}
+
+bool WidgetSnapshot::open(FilePathView path)
+{
+	// ファイルの中身をそのまま構造体として読む
+	static_assert(std::is_trivially_copyable_v<Header>);
+	static_assert(std::is_trivially_copyable_v<NodeRecord>);
+	static_assert(std::is_trivially_copyable_v<StyleRecord>);
+	static_assert(alignof(NodeRecord) <= 4 && alignof(StyleRecord) <= 4);
+
+	close();
+
+	if (not m_file.open(path))
+	{
+		return false;
+	}
+
+	const auto memory = m_file.mapAll();
+	const Byte* data = memory.data;
+	const size_t size = memory.size;
+
+	auto fits = [&](uint64 offset, uint64 count, uint64 elementSize)
+		{
+			return offset % 4 == 0 && offset + count * elementSize <= size;
+		};
+
+	const auto* header = reinterpret_cast<const Header*>(data);
+
+	if (not data ||
+		size < sizeof(Header) ||
+		header->magic != Magic ||
+		header->version != FormatVersion ||
+		header->nodeCount == 0 ||
+		not fits(header->nodesOffset, header->nodeCount, sizeof(NodeRecord)) ||
+		not fits(header->stylesOffset, header->styleCount, sizeof(StyleRecord)) ||
+		not fits(header->stringsOffset, header->stringLength, sizeof(char32)))
+	{
+		close();
+		return false;
+	}
+
+	const auto* nodes = reinterpret_cast<const NodeRecord*>(data + header->nodesOffset);
+
+	// 後から範囲を調べずに済むよう、開くときに全ノードを確かめる
+	// 子の数の合計がノード数と合わなければ木になっていない
+	uint64 childTotal = 0;
+	for (size_t i = 0; i < header->nodeCount; i++)
+	{
+		const auto& node = nodes[i];
+		childTotal += node.childCount;
+
+		if (node.styleIndex >= header->styleCount ||
+			(node.type == WidgetType::Label && node.childCount > 0) ||
+			node.type > WidgetType::Label ||
+			uint64{ node.nameOffset } + node.nameLength > header->stringLength ||
+			uint64{ node.textOffset } + node.textLength > header->stringLength)
+		{
+			close();
+			return false;
+		}
+	}
+
+	if (childTotal + 1 != header->nodeCount)
+	{
+		close();
+		return false;
+	}
+
+	m_header = header;
+	m_nodes = nodes;
+	m_styles = reinterpret_cast<const StyleRecord*>(data + header->stylesOffset);
+	m_strings = reinterpret_cast<const char32*>(data + header->stringsOffset);
+	return true;
+}
+
+void WidgetSnapshot::close()
+{
+	m_header = nullptr;
+	m_nodes = nullptr;
+	m_styles = nullptr;
+	m_strings = nullptr;
+
+	if (m_file)
+	{
+		m_file.unmap();
+		m_file.close();
+	}
+}
+
+SizeF WidgetSnapshot::layoutSize() const
+{
+	return{ m_header->width, m_header->height };
+}
+
+size_t WidgetSnapshot::nodeCount() const
+{
+	return m_header->nodeCount;
+}
+
+WidgetSnapshot::WidgetType WidgetSnapshot::type(size_t index) const
+{
+	return m_nodes[index].type;
+}
+
+size_t WidgetSnapshot::childCount(size_t index) const
+{
+	return m_nodes[index].childCount;
+}
+
+StringView WidgetSnapshot::name(size_t index) const
+{
+	return{ m_strings + m_nodes[index].nameOffset, m_nodes[index].nameLength };
+}
+
+StringView WidgetSnapshot::text(size_t index) const
+{
+	return{ m_strings + m_nodes[index].textOffset, m_nodes[index].textLength };
+}
+
+Optional<LayoutResults> WidgetSnapshot::layoutResults(size_t index) const
+{
+	const auto& node = m_nodes[index];
+
+	if (not node.hasLayout)
+	{
+		return none;
+	}
+
+	const auto& l = node.layout;
+
+	return LayoutResults{
+		.offset = { l[0], l[1] },
+		.margin = { l[6], l[7], l[8], l[9] },
+		.localRect = { l[2], l[3], l[4], l[5] },
+		.border = { l[10], l[11], l[12], l[13] },
+		.padding = { l[14], l[15], l[16], l[17] },
+	};
+}
+
+void WidgetSnapshot::draw(const Font& font) const
+{
+	if (isOpen())
+	{
+		drawNode(0, font);
+	}
+}
+
+size_t WidgetSnapshot::drawNode(size_t index, const Font& font) const
+{
+	const auto& node = m_nodes[index];
+	const auto layout = layoutResults(index);
+
+	if (layout && node.type == WidgetType::Label)
+	{
+		font(text(index)).draw(layout->innerRect(), DecodeColor(node.color));
+	}
+
+	// 子は先行順で直後に並ぶ
+	size_t next = index + 1;
+	for (uint32 i = 0; i < node.childCount; i++)
+	{
+		next = drawNode(next, font);
+	}
+
+	// Widget::drawと同じく、枠は子の後に描く
+	const ColorF borderColor = DecodeColor(node.borderColor);
+	if (layout && borderColor.a != 0)
+	{
+		BoxRenderer::DrawFrame(layout->rect(), layout->border, borderColor);
+	}
+
+	return next;
+}
+
+std::shared_ptr<Widget> WidgetSnapshot::instantiate(WidgetPool* pool) const
+{
+	if (not isOpen())
+	{
+		return nullptr;
+	}
+
+	Array<StyleClass::Pointer> styles(m_header->styleCount);
+	for (size_t i = 0; i < styles.size(); i++)
+	{
+		styles[i] = StyleClass::Intern(m_styles[i].decode());
+	}
+
+	// 子を待っている親と、その残りの子の数
+	Array<std::pair<Widget*, uint32>> parents;
+	std::shared_ptr<Widget> root;
+
+	for (size_t i = 0; i < m_header->nodeCount; i++)
+	{
+		const auto& node = m_nodes[i];
+
+		std::shared_ptr<Widget> widget;
+		if (node.type == WidgetType::Label)
+		{
+			auto label = WidgetPool::Create<Label>(pool);
+			label->setText(text(i));
+			label->setColor(DecodeColor(node.color));
+			widget = std::move(label);
+		}
+		else
+		{
+			widget = WidgetPool::Create<Widget>(pool);
+		}
+
+		widget->setName(name(i));
+		widget->borderColor = DecodeColor(node.borderColor);
+		widget->setStyleClass(styles[node.styleIndex]);
+
+		Widget* pointer = widget.get();
+
+		if (parents.empty())
+		{
+			root = std::move(widget);
+		}
+		else
+		{
+			auto& [parent, remaining] = parents.back();
+			parent->appendChild(std::move(widget));
+
+			if (--remaining == 0)
+			{
+				parents.pop_back();
+			}
+		}
+
+		if (node.childCount > 0)
+		{
+			parents.emplace_back(pointer, node.childCount);
+		}
+	}
+
+	return root;
+}
+
+WidgetSnapshot::~WidgetSnapshot()
+{
+	close();
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "Widget.hpp"
+#include "WidgetPool.hpp"
+
+// Widgetツリーと、ある大きさで計算したレイアウト結果を保存したバイナリ
+// メモリマップで開き、名前や文字はファイル上のUTF-32をそのまま指す
+// 起動直後はWidgetを作らずにこれを描き、ツリーの構築とレイアウトは後で行える
+class WidgetSnapshot
+{
+public:
+
+	// 形式を変えたら増やす。版の違うファイルは開けない
+	static constexpr uint32 FormatVersion = 1;
+
+	enum class WidgetType : uint8
+	{
+		Widget,
+		Label,
+	};
+
+	WidgetSnapshot() = default;
+
+	explicit WidgetSnapshot(FilePathView path);
+
+	WidgetSnapshot(const WidgetSnapshot&) = delete;
+
+	WidgetSnapshot& operator=(const WidgetSnapshot&) = delete;
+
+	// rootから下の全Widgetを保存する。レイアウト結果のないWidgetは結果なしで保存される
+	// layoutSizeはレイアウトを計算したときの大きさ
+	static bool Save(FilePathView path, const Widget& root, SizeF layoutSize);
+
+public:
+
+	// 形式や範囲が正しくない場合は開かない
+	bool open(FilePathView path);
+
+	void close();
+
+	bool isOpen() const noexcept { return m_header != nullptr; }
+
+	explicit operator bool() const noexcept { return isOpen(); }
+
+	SizeF layoutSize() const;
+
+	// ノードは先行順に並ぶ (0が根)
+	size_t nodeCount() const;
+
+	WidgetType type(size_t index) const;
+
+	size_t childCount(size_t index) const;
+
+	// ファイルを閉じるまで有効
+	StringView name(size_t index) const;
+
+	StringView text(size_t index) const;
+
+	Optional<LayoutResults> layoutResults(size_t index) const;
+
+	// Widgetを作らずに保存時のレイアウトで描く。Labelの文字はfontで描く
+	void draw(const Font& font = SimpleGUI::GetFont()) const;
+
+	// Widgetツリーを組み立てる。同じスタイルはStyleClassで共有される
+	// poolを渡した場合、Widgetはそこから作る
+	std::shared_ptr<Widget> instantiate(WidgetPool* pool = nullptr) const;
+
+private:
+
+	struct Header;
+
+	struct NodeRecord;
+
+	struct StyleRecord;
+
+	MemoryMappedFileView m_file;
+
+	const Header* m_header = nullptr;
+
+	const NodeRecord* m_nodes = nullptr;
+
+	const StyleRecord* m_styles = nullptr;
+
+	const char32* m_strings = nullptr;
+
+	size_t drawNode(size_t index, const Font& font) const;
+
+public:
+
+	~WidgetSnapshot();
+};
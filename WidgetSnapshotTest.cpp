@@ -0,0 +1,81 @@
+﻿#include "WidgetSnapshot.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+
+namespace
+{
+	constexpr size_t NodeCount = 2'000;
+
+	constexpr SizeF Viewport{ 1280, 720 };
+
+	// 保存したレイアウト結果と、スナップショットから作り直したツリーのレイアウト結果は一致する
+	const UnitTest::Registration WidgetSnapshotTest{ U"WidgetSnapshot", [](Array<String>& failures)
+		{
+			const FilePath path = FileSystem::PathAppend(FileSystem::TemporaryDirectoryPath(), U"widget_snapshot_test.snapshot");
+
+			{
+				auto root = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::TextGrid, NodeCount);
+				root->children().back()->setName(U"last row");
+				LayoutTree tree{ root };
+				tree.calculateLayout(static_cast<float>(Viewport.x), static_cast<float>(Viewport.y));
+
+				if (not WidgetSnapshot::Save(path, *root, Viewport))
+				{
+					failures << U"failed to write {}"_fmt(path);
+					return;
+				}
+			}
+
+			WidgetSnapshot snapshot{ path };
+
+			if (not snapshot || snapshot.layoutSize() != Viewport)
+			{
+				failures << U"failed to open {}"_fmt(path);
+				return;
+			}
+
+			auto root = snapshot.instantiate();
+			LayoutTree tree{ root };
+			tree.calculateLayout(static_cast<float>(Viewport.x), static_cast<float>(Viewport.y));
+
+			// 先行順に辿って、保存した結果と比べる
+			size_t index = 0, mismatches = 0;
+			Array<const Widget*> stack{ root.get() };
+			while (not stack.empty())
+			{
+				const Widget* widget = stack.back();
+				stack.pop_back();
+
+				const auto saved = snapshot.layoutResults(index);
+				const auto current = widget->layoutResults();
+				if (not saved || not current || saved->rect() != current->rect() || snapshot.name(index) != widget->name())
+				{
+					mismatches++;
+				}
+				index++;
+
+				for (auto it = widget->children().rbegin(); it != widget->children().rend(); ++it)
+				{
+					stack.push_back(it->get());
+				}
+			}
+
+			if (index != snapshot.nodeCount())
+			{
+				failures << U"instantiated {} of {} saved nodes"_fmt(index, snapshot.nodeCount());
+			}
+
+			if (mismatches)
+			{
+				failures << U"snapshot layout differs from the instantiated tree in {} widgets"_fmt(mismatches);
+			}
+
+			snapshot.close();
+			FileSystem::Remove(path);
+		} };
+}
+
+#endif
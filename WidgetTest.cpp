@@ -0,0 +1,146 @@
+﻿#include "Widget.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+
+namespace
+{
+	constexpr size_t NodeCount = 2'000;
+
+	// 索引を使わない元の順序 (子が先、自身が後) で集める
+	void CollectNamed(Widget& widget, StringView name, Array<Widget*>& result)
+	{
+		for (auto& child : widget.children())
+		{
+			CollectNamed(*child, name, result);
+		}
+
+		if (widget.name() == name)
+		{
+			result.push_back(&widget);
+		}
+	}
+
+	void CollectAll(Widget& widget, Array<Widget*>& result)
+	{
+		result.push_back(&widget);
+
+		for (auto& child : widget.children())
+		{
+			CollectAll(*child, result);
+		}
+	}
+
+	// queryAllとqueryを、辿って集めた結果と並びまで比べる
+	void CompareWithTraversal(Widget& scope, StringView step, Array<String>& failures)
+	{
+		Array<Widget*> expected;
+		CollectNamed(scope, U"red", expected);
+
+		const auto actual = scope.queryAll(U"red");
+		const bool same = (actual.size() == expected.size()) &&
+			std::equal(actual.begin(), actual.end(), expected.begin(), [](const auto& a, Widget* b) { return a.get() == b; });
+
+		if (not same)
+		{
+			failures << U"{}: queryAll returned {} widgets, the traversal {} (or in a different order)"_fmt(step, actual.size(), expected.size());
+		}
+
+		const auto first = scope.query(U"red");
+		if (first.get() != (expected ? expected.front() : nullptr))
+		{
+			failures << U"{}: query did not return the first match in tree order"_fmt(step);
+		}
+
+		const auto limited = scope.queryAll(U"red", 3);
+		if (limited.size() != Min<size_t>(expected.size(), 3))
+		{
+			failures << U"{}: queryAll with a limit of 3 returned {} widgets"_fmt(step, limited.size());
+		}
+	}
+
+	const UnitTest::Registration WidgetQueryTest{ U"Widget::queryAll", [](Array<String>& failures)
+		{
+			const auto root = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::Balanced, NodeCount);
+
+			Array<Widget*> widgets;
+			CollectAll(*root, widgets);
+
+			for (auto [i, widget] : Indexed(widgets))
+			{
+				if (i % 5 == 0)
+				{
+					widget->setName(U"red");
+				}
+			}
+
+			// LayoutTreeに属する前は全体を辿る
+			CompareWithTraversal(*root, U"without index", failures);
+
+			LayoutTree tree{ root };
+			CompareWithTraversal(*root, U"indexed", failures);
+
+			for (Widget* scope : { widgets[1], widgets[widgets.size() / 3], widgets.back() })
+			{
+				CompareWithTraversal(*scope, U"indexed scope", failures);
+			}
+
+			// 取り除く、前に差し込む、並べ替える、名前を変えると、索引の中の並びが崩れる
+			SmallRNG rng{ 12345 };
+			for (size_t i = 0; i < 16; i++)
+			{
+				Array<Widget*> current;
+				CollectAll(*root, current);
+				Widget& parent = *current[Random(current.size() / 8, rng)];
+
+				if (parent.children().empty())
+				{
+					continue;
+				}
+
+				switch (i % 4)
+				{
+				case 0:
+					{
+						const auto child = parent.children().back();
+						parent.removeChild(child);
+					}
+					break;
+
+				case 1:
+					{
+						auto child = std::make_shared<Widget>();
+						child->setName(U"red");
+						child->appendChild(std::make_shared<Widget>());
+						child->children().front()->setName(U"red");
+						parent.insertChild(0, std::move(child));
+					}
+					break;
+
+				case 2:
+					{
+						const auto child = parent.children().back();
+						parent.moveChild(child, 0);
+					}
+					break;
+
+				case 3:
+					parent.children().front()->setName(parent.children().front()->name() == U"red" ? U"" : U"red");
+					break;
+				}
+
+				CompareWithTraversal(*root, U"after edit {}"_fmt(i), failures);
+			}
+
+			CompareWithTraversal(*root->children().front(), U"scope after edits", failures);
+
+			if (root->query(U"not a name"))
+			{
+				failures << U"query matched a name no widget has";
+			}
+		} };
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <yoga/node/Node.h>
 #include <yoga/enums/FlexDirection.h>
 #include "Label.hpp"
+#include "StyleFormat.hpp"
 
 using namespace facebook;
 
@@ -68,60 +69,6 @@ static std::string StyleLengthToString(yoga::StyleLength value)
 }
 
 
-static std::optional<yoga::StyleLength> TryParseStyleLength(std::string_view input)
-{
-	constexpr auto trimCharList = " \t\v\r\n";
-
-	// 空白を取り除く(trim関数の代わり)
-	{
-		std::string::size_type left = input.find_first_not_of(trimCharList);
-		if (left != std::string::npos)
-		{
-			std::string::size_type right = input.find_last_not_of(trimCharList);
-			input = input.substr(left, right - left + 1);
-		}
-	}
-
-	// Undefined
-	if (input == "" || input == "undefined")
-	{
-		return yoga::StyleLength::undefined();
-	}
-
-	// Auto
-	if (input == "auto")
-	{
-		return yoga::StyleLength::ofAuto();
-	}
-
-	// Percent
-	if (input.ends_with('%'))
-	{
-		try
-		{
-			return yoga::StyleLength::percent(
-				std::stof(std::string{ input.substr(0, input.size() - 1) }) / 100.f
-			);
-		}
-		catch (std::invalid_argument)
-		{
-			return none;
-		}
-	}
-
-	// Point
-	try
-	{
-		return yoga::StyleLength::points(
-			std::stof(std::string{ input })
-		);
-	}
-	catch (std::invalid_argument)
-	{
-		return none;
-	}
-}
-
 static std::optional<yoga::StyleLength> CreateStyleLengthInput(
 	const char* label,
 	const char* hint,
@@ -133,7 +80,7 @@ static std::optional<yoga::StyleLength> CreateStyleLengthInput(
 		ImGuiInputTextFlags_CharsNoBlank |
 		ImGuiInputTextFlags_EnterReturnsTrue))
 	{
-		return TryParseStyleLength(str);
+		return StyleFormat::TryParseLength(str);
 	}
 	return none;
 }
@@ -375,7 +322,7 @@ static bool ShowStyleEditor(yoga::Style& style)
 	return valueChanged;
 }
 
-bool RenderWidgetTreeNode(std::shared_ptr<Widget> widget, std::shared_ptr<Widget>& selectedWidget)
+bool RenderWidgetTreeNode(const std::shared_ptr<Widget>& widget, std::shared_ptr<Widget>& selectedWidget)
 {
 	bool treeChanged = false;
 	auto id = widget->id();
@@ -387,7 +334,7 @@ bool RenderWidgetTreeNode(std::shared_ptr<Widget> widget, std::shared_ptr<Widget
 		flags |= ImGuiTreeNodeFlags_Selected;
 	}
 
-	bool showChildren = ImGui::TreeNodeEx(reinterpret_cast<void*>(id), flags, "0x%08x", id);
+	bool showChildren = ImGui::TreeNodeEx(reinterpret_cast<void*>(id), flags, "%u:%u", WidgetSlotMap::Index(id), WidgetSlotMap::Generation(id));
 
 	if (not showChildren)
 	{
@@ -402,7 +349,7 @@ bool RenderWidgetTreeNode(std::shared_ptr<Widget> widget, std::shared_ptr<Widget
 
 	if (showChildren)
 	{
-		for (auto& child : widget->children)
+		for (auto& child : widget->children())
 		{
 			treeChanged |= RenderWidgetTreeNode(child, selectedWidget);
 		}
@@ -419,35 +366,36 @@ bool WidgetTreeEditor::update()
 	showSelectedWidgetEditor();
 
 	// mouseOver中のウィジェットを検索
-	std::shared_ptr<Widget> hoveredWidget, hoveredParentWidget;
+	Widget* hoveredWidget = nullptr;
 	if (!ImGui::GetIO().WantCaptureMouse)
 	{
-		mouseOverTest(m_root, hoveredWidget, hoveredParentWidget);
+		hoveredWidget = m_tree.hitTest(Cursor::PosF());
 	}
 
 	// m_selectedWidgetを切り替え
 	if (hoveredWidget && MouseL.down())
 	{
-		if (m_selectedWidget == hoveredWidget)
+		if (m_selectedWidget.get() == hoveredWidget)
 		{
 			m_selectedWidget.reset();
 			m_selectedWidgetParent.reset();
 		}
 		else
 		{
-			m_selectedWidget = hoveredWidget;
-			m_selectedWidgetParent = hoveredParentWidget;
+			auto parent = hoveredWidget->parent();
+			m_selectedWidget = hoveredWidget->shared_from_this();
+			m_selectedWidgetParent = parent ? parent->shared_from_this() : nullptr;
 		}
 	}
 
 	// -----描画-----
 
 	// LayoutResultsを描画
-	if (hoveredWidget)
+	if (auto layout = hoveredWidget ? hoveredWidget->layoutResults() : none)
 	{
-		drawLayoutResults(*hoveredWidget->layoutResults());
+		drawLayoutResults(*layout);
 	}
-	else if (m_selectedWidget)
+	else if (m_selectedWidget && m_selectedWidget->layoutResults())
 	{
 		drawLayoutResults(*m_selectedWidget->layoutResults());
 	}
@@ -462,60 +410,23 @@ bool WidgetTreeEditor::update()
 		}
 	}
 
-	return m_treeChanged;
-}
-
-bool WidgetTreeEditor::mouseOverTest(
-	std::shared_ptr<Widget> widget,
-	std::shared_ptr<Widget>& hoveredWidget,
-	std::shared_ptr<Widget>& hoveredParentWidget)
-{
-	auto layout = widget->layoutResults();
-
-	if (!layout.has_value())
-	{
-		return false;
-	}
-
-	for (auto [i, child] : ReverseIndexedRef(widget->children))
-	{
-		if (mouseOverTest(child, hoveredWidget, hoveredParentWidget))
-		{
-			if (!hoveredParentWidget)
-			{
-				hoveredParentWidget = widget;
-			}
-			return true;
-		}
-	}
-
-	if (layout->rect().mouseOver())
-	{
-		hoveredWidget = widget;
-		return true;
-	}
-
-	return false;
+	return std::exchange(m_treeChanged, false);
 }
 
 void WidgetTreeEditor::drawLayoutResults(LayoutResults layout)
 {
-	for (auto polygon : Geometry2D::Subtract(layout.outerRect(), layout.rect().asPolygon()))
+	if (m_overlayLayout != layout)
 	{
-		polygon.draw(MarginColor);
-	}
+		m_overlay.clear();
+		m_overlay.addFrame(layout.outerRect(), layout.margin, MarginColor);
+		m_overlay.addFrame(layout.rect(), layout.border, BorderColor);
+		m_overlay.addFrame(layout.rectWithoutBorder(), layout.padding, PaddingColor);
+		m_overlay.addRect(layout.innerRect(), InnerRectColor);
 
-	for (auto polygon : Geometry2D::Subtract(layout.rect(), layout.rectWithoutBorder().asPolygon()))
-	{
-		polygon.draw(BorderColor);
+		m_overlayLayout = layout;
 	}
 
-	for (auto polygon : Geometry2D::Subtract(layout.rectWithoutBorder(), layout.innerRect().asPolygon()))
-	{
-		polygon.draw(PaddingColor);
-	}
-
-	layout.innerRect().draw(InnerRectColor);
+	m_overlay.draw();
 }
 
 void WidgetTreeEditor::showPropertyEditor(Widget& widget)
@@ -548,16 +459,25 @@ void WidgetTreeEditor::showSelectedWidgetEditor()
 
 	if (m_selectedWidget && ImGui::Begin("Selected Widget", &isItemSelected, ImGuiWindowFlags_NoCollapse))
 	{
-		ImGui::Text("ID: 0x%08x (%s)", m_selectedWidget->id(), typeid(*m_selectedWidget.get()).name());
+		const auto id = m_selectedWidget->id();
+		ImGui::Text("ID: %u (generation %u) (%s)", WidgetSlotMap::Index(id), WidgetSlotMap::Generation(id), typeid(*m_selectedWidget.get()).name());
 
 		ImGui::PushID(m_selectedWidget.get());
 
 		if (ImGui::CollapsingHeader("Tree"))
 		{
-			auto name = Unicode::ToUTF8(m_selectedWidget->name);
-			if (ImGui::InputText("Name", &name))
+			// 途中の名前を登録してstructureVersionを進めないよう、Enterかフォーカスを外したときに確定する
+			if (m_nameEditing != m_selectedWidget.get())
+			{
+				m_nameBuffer = Unicode::ToUTF8(m_selectedWidget->name());
+			}
+
+			ImGui::InputText("Name", &m_nameBuffer);
+			m_nameEditing = ImGui::IsItemActive() ? m_selectedWidget.get() : nullptr;
+
+			if (ImGui::IsItemDeactivatedAfterEdit())
 			{
-				m_selectedWidget->name = Unicode::FromUTF8(name);
+				m_selectedWidget->setName(Unicode::FromUTF8(m_nameBuffer));
 			}
 
 			ImGui::Spacing();
@@ -565,24 +485,24 @@ void WidgetTreeEditor::showSelectedWidgetEditor()
 			ImGui::BeginDisabled(!m_selectedWidget->allowChildren());
 			if (ImGui::Button("[+] Add Child Widget"))
 			{
-				auto newChild = std::make_shared<Widget>();
+				auto newChild = WidgetPool::Create<Widget>(m_pool.get());
 				{
 					newChild->borderColor = Palette::Black;
 					newChild->style().setDimension(yoga::Dimension::Width, yoga::Style::Length::points(100));
 					newChild->style().setDimension(yoga::Dimension::Height, yoga::Style::Length::points(100));
 					newChild->style().setBorder(yoga::Edge::All, yoga::Style::Length::points(1));
 				}
-				m_selectedWidget->children.emplace_back(std::move(newChild));
+				m_selectedWidget->appendChild(std::move(newChild));
 				m_treeChanged = true;
 			}
 			if (ImGui::Button("[+] Add Child Label"))
 			{
-				auto newChild = std::make_shared<Label>();
+				auto newChild = WidgetPool::Create<Label>(m_pool.get());
 				{
 					newChild->setColor(Palette::Black);
 					newChild->setText(U"Label");
 				}
-				m_selectedWidget->children.emplace_back(std::move(newChild));
+				m_selectedWidget->appendChild(std::move(newChild));
 				m_treeChanged = true;
 			}
 			ImGui::EndDisabled();
@@ -592,7 +512,7 @@ void WidgetTreeEditor::showSelectedWidgetEditor()
 			ImGui::BeginDisabled(!m_selectedWidgetParent);
 			if (ImGui::Button("[-] Remove Widget") || (m_selectedWidgetParent && KeyDelete.down()))
 			{
-				m_selectedWidgetParent->children.remove(m_selectedWidget);
+				m_selectedWidgetParent->removeChild(m_selectedWidget);
 				isItemSelected = false;
 				m_treeChanged = true;
 			}
@@ -610,9 +530,9 @@ void WidgetTreeEditor::showSelectedWidgetEditor()
 		{
 			if (ImGui::CollapsingHeader("Style"))
 			{
-				if (ShowStyleEditor(node->getStyle()))
+				if (ShowStyleEditor(m_selectedWidget->style()))
 				{
-					node->markDirtyAndPropagate();
+					m_selectedWidget->markLayoutDirty();
 				}
 			}
 		}
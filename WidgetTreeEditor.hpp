@@ -1,37 +1,56 @@
 ﻿#pragma once
 #include "Widget.hpp"
+#include "WidgetPool.hpp"
+#include "LayoutTree.hpp"
+#include "BoxRenderer.hpp"
 
 class WidgetTreeEditor
 {
 public:
 
-	WidgetTreeEditor(std::shared_ptr<Widget> root)
-		: m_root(root) { }
+	// マウスの下のWidgetはtreeの当たり判定の索引で探す
+	// 追加するWidgetはpoolから作る (nullptrの場合はstd::make_shared)
+	WidgetTreeEditor(LayoutTree& tree, std::shared_ptr<Widget> root, std::shared_ptr<WidgetPool> pool = nullptr)
+		: m_tree(tree)
+		, m_root(root)
+		, m_pool(std::move(pool)) { }
 
 public:
 
-	Color MarginColor{ 176, 131, 84, 180 };
-	Color BorderColor{ 228, 196, 130, 180 };
-	Color PaddingColor{ 184, 196, 128, 180 };
-	Color InnerRectColor{ 136, 178, 189, 180 };
+	static constexpr Color MarginColor{ 176, 131, 84, 180 };
+	static constexpr Color BorderColor{ 228, 196, 130, 180 };
+	static constexpr Color PaddingColor{ 184, 196, 128, 180 };
+	static constexpr Color InnerRectColor{ 136, 178, 189, 180 };
 
 	Color SelectedWidgetFrameColor{ 86, 117, 9, 200 };
 
+	// このフレームでツリーの構成を変更した場合はtrue
 	bool update();
 
-	bool isTreeChanged() const { return m_treeChanged; }
-
 private:
 
+	LayoutTree& m_tree;
+
 	std::shared_ptr<Widget> m_root;
 
+	std::shared_ptr<WidgetPool> m_pool;
+
 	std::shared_ptr<Widget> m_selectedWidget;
 
 	std::shared_ptr<Widget> m_selectedWidgetParent;
 
 	bool m_treeChanged = false;
 
-	bool mouseOverTest(std::shared_ptr<Widget> widget, std::shared_ptr<Widget>& hoveredWidget, std::shared_ptr<Widget>& hoveredParentWidget);
+	// 入力中の名前。確定するまでWidgetへ反映しない
+	std::string m_nameBuffer;
+
+	// 前のフレームでm_nameBufferを編集していたWidget
+	const Widget* m_nameEditing = nullptr;
+
+	// drawLayoutResultsの四角形。色は変わらないので、同じレイアウト結果の間は作り直さない
+	BoxRenderer m_overlay;
+
+	Optional<LayoutResults> m_overlayLayout;
 
 	void drawLayoutResults(LayoutResults layout);
 
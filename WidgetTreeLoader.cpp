@@ -0,0 +1,640 @@
+﻿#include "WidgetTreeLoader.hpp"
+#include "Label.hpp"
+#include "StyleFormat.hpp"
+#include <nlohmann/json.hpp>
+
+using namespace facebook;
+
+namespace
+{
+	void AppendEscaped(std::string& out, StringView s)
+	{
+		out += '"';
+
+		for (char c : Unicode::ToUTF8(s))
+		{
+			switch (c)
+			{
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<uint8>(c) < 0x20)
+				{
+					out += fmt::format("\\u{:04x}", static_cast<uint8>(c));
+				}
+				else
+				{
+					out += c;
+				}
+			}
+		}
+
+		out += '"';
+	}
+
+	void AppendColor(std::string& out, const ColorF& color)
+	{
+		out += fmt::format("[{}, {}, {}, {}]", color.r, color.g, color.b, color.a);
+	}
+
+	void AppendWidget(std::string& out, const Widget& widget)
+	{
+		const auto label = dynamic_cast<const Label*>(&widget);
+
+		out += "{\"type\": ";
+		out += label ? "\"Label\"" : "\"Widget\"";
+
+		if (not widget.name().isEmpty())
+		{
+			out += ", \"name\": ";
+			AppendEscaped(out, widget.name());
+		}
+
+		// 読み込み時に子の領域を先に確保できるよう、childrenより前に書く
+		if (not widget.children().empty())
+		{
+			out += fmt::format(", \"childCount\": {}", widget.children().size());
+		}
+
+		bool firstProperty = true;
+		for (auto& property : StyleFormat::Properties())
+		{
+			if (auto value = property.format(widget.style()))
+			{
+				out += firstProperty ? ", \"style\": {" : ", ";
+				out += fmt::format("\"{}\": \"{}\"", property.name, *value);
+				firstProperty = false;
+			}
+		}
+		if (not firstProperty)
+		{
+			out += '}';
+		}
+
+		if (label)
+		{
+			out += ", \"text\": ";
+			AppendEscaped(out, label->text());
+			out += ", \"color\": ";
+			AppendColor(out, label->color());
+		}
+
+		out += ", \"borderColor\": ";
+		AppendColor(out, widget.borderColor);
+
+		if (not widget.children().empty())
+		{
+			out += ", \"children\": [\n";
+
+			bool firstChild = true;
+			for (auto& child : widget.children())
+			{
+				if (not firstChild)
+				{
+					out += ",\n";
+				}
+				AppendWidget(out, *child);
+				firstChild = false;
+			}
+
+			out += ']';
+		}
+
+		out += '}';
+	}
+
+	size_t CountNodes(const Widget& widget)
+	{
+		size_t count = 1;
+		for (auto& child : widget.children())
+		{
+			count += CountNodes(*child);
+		}
+		return count;
+	}
+
+	// 最も短いノード ("{}") のバイト数
+	constexpr size_t MinNodeBytes = 2;
+
+	// 入力の大きさが分からない場合に、先に確保するWidgetの上限
+	constexpr size_t MaxReserveWithoutSize = 65'536;
+}
+
+// nlohmannのSAXで受け取った値から、その場でWidgetを組み立てる
+class WidgetTreeLoader::Handler : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+
+	// bytesは入力の大きさ (分からなければ0)
+	Handler(bool build, WidgetPool* pool, size_t bytes)
+		: m_build(build)
+		, m_pool(pool)
+		, m_maxNodes(bytes ? (bytes / MinNodeBytes) : MaxReserveWithoutSize)
+	{
+		m_frames.push_back({ .context = Context::Top });
+	}
+
+	std::shared_ptr<Widget> root;
+
+	size_t nodeCount = 0;
+
+	String error;
+
+	bool null() override
+	{
+		return value({ });
+	}
+
+	bool boolean(bool) override
+	{
+		return value({ });
+	}
+
+	bool number_integer(number_integer_t v) override
+	{
+		return value({ .number = static_cast<double>(v) });
+	}
+
+	bool number_unsigned(number_unsigned_t v) override
+	{
+		return value({ .number = static_cast<double>(v) });
+	}
+
+	bool number_float(number_float_t v, const string_t&) override
+	{
+		return value({ .number = v });
+	}
+
+	bool string(string_t& v) override
+	{
+		return value({ .text = v });
+	}
+
+	bool binary(binary_t&) override
+	{
+		return fail(U"binary values are not supported");
+	}
+
+	bool key(string_t& v) override
+	{
+		auto& frame = m_frames.back();
+
+		if (frame.context == Context::Style)
+		{
+			frame.property = StyleFormat::FindProperty(v);
+			if (not frame.property)
+			{
+				return fail(U"unknown style property '{}'"_fmt(Unicode::FromUTF8(v)));
+			}
+		}
+		else
+		{
+			m_key = v;
+		}
+
+		return true;
+	}
+
+	bool start_object(std::size_t) override
+	{
+		auto& frame = m_frames.back();
+
+		switch (frame.context)
+		{
+		case Context::Top:
+			// 一番外側のオブジェクト。キーはまだ無い
+			m_frames.push_back({ .context = Context::Document });
+			return true;
+
+		case Context::Document:
+			if (m_key == "root")
+			{
+				return startNode();
+			}
+			break;
+
+		case Context::Node:
+			if (m_key == "style")
+			{
+				m_frames.push_back({ .context = Context::Style });
+				return true;
+			}
+			break;
+
+		case Context::Children:
+			return startNode();
+
+		case Context::Skip:
+			frame.depth++;
+			return true;
+
+		default:
+			return fail(U"unexpected object");
+		}
+
+		m_frames.push_back({ .context = Context::Skip, .depth = 1 });
+		return true;
+	}
+
+	bool end_object() override
+	{
+		const Context context = m_frames.back().context;
+
+		if (context == Context::Skip)
+		{
+			return endSkip();
+		}
+
+		if (context == Context::Node && not endNode())
+		{
+			return false;
+		}
+
+		m_frames.pop_back();
+		return true;
+	}
+
+	bool start_array(std::size_t) override
+	{
+		auto& frame = m_frames.back();
+
+		if (frame.context == Context::Skip)
+		{
+			frame.depth++;
+			return true;
+		}
+
+		if (frame.context == Context::Node)
+		{
+			if (m_key == "children")
+			{
+				m_frames.push_back({ .context = Context::Children });
+				return true;
+			}
+
+			if (m_key == "color" || m_key == "borderColor")
+			{
+				const bool border = (m_key == "borderColor");
+				(border ? frame.borderColor.emplace() : frame.labelColor) = ColorF{ 0, 0, 0, 1 };
+				m_frames.push_back({ .context = Context::Color, .border = border });
+				return true;
+			}
+		}
+
+		if (frame.context == Context::Top)
+		{
+			return fail(U"the document must be an object");
+		}
+
+		if (frame.context == Context::Style || frame.context == Context::Children || frame.context == Context::Color)
+		{
+			return fail(U"unexpected array");
+		}
+
+		m_frames.push_back({ .context = Context::Skip, .depth = 1 });
+		return true;
+	}
+
+	bool end_array() override
+	{
+		if (m_frames.back().context == Context::Skip)
+		{
+			return endSkip();
+		}
+
+		m_frames.pop_back();
+		return true;
+	}
+
+	bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& e) override
+	{
+		return fail(U"{} (byte {})"_fmt(Unicode::FromUTF8(e.what()), position));
+	}
+
+private:
+
+	enum class Context : uint8
+	{
+		Top,
+		Document,
+		Node,
+		Style,
+		Children,
+		Color,
+		Skip,
+	};
+
+	struct Frame
+	{
+		Context context;
+
+		// Node
+		bool isLabel = false;
+
+		String name;
+
+		String text;
+
+		yoga::Style style;
+
+		ColorF labelColor{ 0, 0, 0, 1 };
+
+		Optional<ColorF> borderColor;
+
+		// m_pending上で、このノードの子が始まる位置
+		size_t childrenBegin = 0;
+
+		size_t childCount = 0;
+
+		// Style
+		const StyleFormat::Property* property = nullptr;
+
+		// Color (書き込む先は1つ下のNode。m_framesが伸びるとポインタは無効になる)
+		bool border = false;
+
+		size_t colorIndex = 0;
+
+		// Skip
+		size_t depth = 0;
+	};
+
+	bool m_build;
+
+	WidgetPool* m_pool;
+
+	size_t m_maxNodes;
+
+	Array<Frame> m_frames;
+
+	std::string m_key;
+
+	// 親の組み立てを待っているWidget。子は親のchildrenBeginから後ろに並ぶ
+	Array<std::shared_ptr<Widget>> m_pending;
+
+	bool fail(String message)
+	{
+		error = std::move(message);
+		return false;
+	}
+
+	bool value(const StyleFormat::Value& v)
+	{
+		auto& frame = m_frames.back();
+
+		switch (frame.context)
+		{
+		case Context::Top:
+			return fail(U"the document must be an object");
+
+		case Context::Document:
+			if (m_key == "nodeCount" && v.number)
+			{
+				// 組み立て待ちのWidgetは最大でも全ノード数
+				reserveHint(0, *v.number);
+			}
+			return true;
+
+		case Context::Node:
+			if (m_key == "type")
+			{
+				if (v.text != "Widget" && v.text != "Label")
+				{
+					return fail(U"unknown widget type '{}'"_fmt(Unicode::FromUTF8(v.text)));
+				}
+				frame.isLabel = (v.text == "Label");
+			}
+			else if (m_key == "name")
+			{
+				frame.name = Unicode::FromUTF8(v.text);
+			}
+			else if (m_key == "text")
+			{
+				frame.text = Unicode::FromUTF8(v.text);
+			}
+			else if (m_key == "childCount" && v.number)
+			{
+				reserveHint(m_pending.size(), *v.number);
+			}
+			return true;
+
+		case Context::Style:
+			if (not frame.property->parse(frame.style, v))
+			{
+				return fail(U"invalid value '{}' for style property '{}'"_fmt(
+					v.number ? Format(*v.number) : Unicode::FromUTF8(v.text), Unicode::FromUTF8(frame.property->name)));
+			}
+			return true;
+
+		case Context::Color:
+			if (not v.number || frame.colorIndex >= 4)
+			{
+				return fail(U"colors must be arrays of up to 4 numbers");
+			}
+			{
+				auto& node = m_frames[m_frames.size() - 2];
+				ColorF& color = frame.border ? *node.borderColor : node.labelColor;
+				const std::array<double*, 4> components{ &color.r, &color.g, &color.b, &color.a };
+				*components[frame.colorIndex++] = *v.number;
+			}
+			return true;
+
+		case Context::Skip:
+			return true;
+
+		default:
+			return fail(U"unexpected value in children");
+		}
+	}
+
+	// ファイルに書かれた数は信用せず、確保の目安としてだけ使う
+	// 0以上の有限な整数でなければ無視し、入力に収まり得るノード数までに切り詰める
+	void reserveHint(size_t base, double count)
+	{
+		if (not m_build || not std::isfinite(count) || count < 0 || count != std::floor(count))
+		{
+			return;
+		}
+
+		const size_t hint = static_cast<size_t>(Min(count, static_cast<double>(m_maxNodes)));
+		m_pending.reserve(Min(base + hint, m_maxNodes));
+	}
+
+	bool startNode()
+	{
+		// 親のNodeはChildrenの1つ下にある
+		if (m_frames.back().context == Context::Children)
+		{
+			m_frames[m_frames.size() - 2].childCount++;
+		}
+
+		m_frames.push_back({ .context = Context::Node, .childrenBegin = m_pending.size() });
+		return true;
+	}
+
+	bool endNode()
+	{
+		nodeCount++;
+
+		auto& frame = m_frames.back();
+
+		if (frame.isLabel && frame.childCount > 0)
+		{
+			return fail(U"Label cannot have children");
+		}
+
+		if (not m_build)
+		{
+			return true;
+		}
+
+		std::shared_ptr<Widget> widget;
+		if (frame.isLabel)
+		{
+			auto label = WidgetPool::Create<Label>(m_pool);
+			label->setText(frame.text);
+			label->setColor(frame.labelColor);
+			widget = std::move(label);
+		}
+		else
+		{
+			widget = WidgetPool::Create<Widget>(m_pool);
+		}
+
+		widget->setName(frame.name);
+		if (frame.borderColor)
+		{
+			widget->borderColor = *frame.borderColor;
+		}
+		widget->setStyleClass(StyleClass::Intern(frame.style));
+
+		WidgetTreeLoader::AdoptChildren(*widget, m_pending, frame.childrenBegin);
+
+		// 根のNodeはDocumentの1つ下にある
+		if (m_frames[m_frames.size() - 2].context == Context::Document)
+		{
+			root = std::move(widget);
+		}
+		else
+		{
+			m_pending.push_back(std::move(widget));
+		}
+
+		return true;
+	}
+
+	bool endSkip()
+	{
+		if (--m_frames.back().depth == 0)
+		{
+			m_frames.pop_back();
+		}
+		return true;
+	}
+};
+
+bool WidgetTreeLoader::Save(FilePathView path, const Widget& root)
+{
+	std::string out = fmt::format("{{\"nodeCount\": {}, \"root\": ", CountNodes(root));
+	AppendWidget(out, root);
+	out += "}\n";
+
+	TextWriter writer{ path };
+	if (not writer)
+	{
+		return false;
+	}
+
+	writer.writeUTF8(out);
+	return true;
+}
+
+std::shared_ptr<Widget> WidgetTreeLoader::load(FilePathView path, WidgetPool* pool)
+{
+	std::ifstream stream{ std::filesystem::path{ path.toWstr() }, std::ios::binary };
+	if (not stream)
+	{
+		m_error = U"failed to open {}"_fmt(path);
+		return nullptr;
+	}
+
+	return load(stream, pool);
+}
+
+std::shared_ptr<Widget> WidgetTreeLoader::load(std::istream& stream, WidgetPool* pool)
+{
+	return run(stream, true, pool);
+}
+
+bool WidgetTreeLoader::parse(FilePathView path)
+{
+	std::ifstream stream{ std::filesystem::path{ path.toWstr() }, std::ios::binary };
+	if (not stream)
+	{
+		m_error = U"failed to open {}"_fmt(path);
+		return false;
+	}
+
+	return parse(stream);
+}
+
+bool WidgetTreeLoader::parse(std::istream& stream)
+{
+	run(stream, false, nullptr);
+	return m_error.isEmpty();
+}
+
+std::shared_ptr<Widget> WidgetTreeLoader::run(std::istream& stream, bool build, WidgetPool* pool)
+{
+	m_stats = { };
+	m_error.clear();
+
+	// 読み込む量は先に調べておく (読み終えた後はEOFでtellgが使えない)
+	const auto begin = stream.tellg();
+	stream.seekg(0, std::ios::end);
+	const auto end = stream.tellg();
+	stream.seekg(begin);
+	const size_t bytes = (begin >= 0 && end >= begin) ? static_cast<size_t>(end - begin) : 0;
+
+	Stopwatch sw{ StartImmediately::Yes };
+
+	Handler handler{ build, pool, bytes };
+	const bool succeeded = nlohmann::json::sax_parse(stream, &handler);
+
+	m_stats.microseconds = sw.usF();
+	m_stats.nodeCount = handler.nodeCount;
+	m_stats.bytes = bytes;
+
+	if (not succeeded)
+	{
+		m_error = handler.error.isEmpty() ? U"parse error" : handler.error;
+		return nullptr;
+	}
+
+	if (build && not handler.root)
+	{
+		m_error = U"no root widget";
+		return nullptr;
+	}
+
+	if (not build && handler.nodeCount == 0)
+	{
+		m_error = U"no root widget";
+	}
+
+	return handler.root;
+}
+
+void WidgetTreeLoader::AdoptChildren(Widget& parent, Array<std::shared_ptr<Widget>>& pending, size_t begin)
+{
+	parent.m_children.reserve(parent.m_children.size() + (pending.size() - begin));
+
+	for (auto it = pending.begin() + begin; it != pending.end(); ++it)
+	{
+		(*it)->m_parent = &parent;
+		parent.m_children.push_back(std::move(*it));
+	}
+
+	pending.erase(pending.begin() + begin, pending.end());
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <Siv3D.hpp>
+#include "Widget.hpp"
+#include "WidgetPool.hpp"
+
+// JSONで書かれたWidgetツリーを、文書全体を読み込まずに先頭から読みながら組み立てる
+//
+// { "nodeCount": 3, "root": { "type": "Widget", "name": "root", "childCount": 2,
+//   "style": { "flexDirection": "row", "padding": "8", "width": "50%" },
+//   "borderColor": [0, 0, 0, 1], "children": [ { "type": "Label", "text": "Hello", "color": [0, 0, 0, 1] }, ... ] } }
+//
+// スタイルの値はStyleFormatの書式で書く。nodeCountとchildCountは省略でき、
+// childrenより前に書かれていれば組み立て用の領域をまとめて確保する
+class WidgetTreeLoader
+{
+public:
+
+	// 直前のparseまたはloadの結果
+	struct Stats
+	{
+		size_t nodeCount = 0;
+
+		size_t bytes = 0;
+
+		// 読み込み全体にかかった時間 (マイクロ秒)
+		double microseconds = 0;
+
+		double nodesPerSecond() const noexcept { return microseconds > 0 ? nodeCount / microseconds * 1e6 : 0; }
+
+		double megabytesPerSecond() const noexcept { return microseconds > 0 ? bytes / microseconds : 0; }
+	};
+
+	// rootから下の全Widgetを書き出す。スタイルは既定値と異なる項目だけを書く
+	static bool Save(FilePathView path, const Widget& root);
+
+public:
+
+	// 失敗した場合はnullptrを返し、error()に理由が入る
+	// poolを渡した場合、Widgetはそこから作る
+	std::shared_ptr<Widget> load(FilePathView path, WidgetPool* pool = nullptr);
+
+	std::shared_ptr<Widget> load(std::istream& stream, WidgetPool* pool = nullptr);
+
+	// Widgetを作らずに、文法とスタイルの値だけを確かめる
+	bool parse(FilePathView path);
+
+	bool parse(std::istream& stream);
+
+	const Stats& stats() const noexcept { return m_stats; }
+
+	const String& error() const noexcept { return m_error; }
+
+private:
+
+	class Handler;
+
+	Stats m_stats;
+
+	String m_error;
+
+	std::shared_ptr<Widget> run(std::istream& stream, bool build, WidgetPool* pool);
+
+	// pendingのbegin以降をparentの子にする。appendChildと違い子ごとに末尾を探さない
+	static void AdoptChildren(Widget& parent, Array<std::shared_ptr<Widget>>& pending, size_t begin);
+};
@@ -0,0 +1,139 @@
+﻿#include "WidgetTreeLoader.hpp"
+
+#ifdef SIV3D_YOGA_TEST
+
+#include <sstream>
+#include "UnitTest.hpp"
+#include "LayoutBenchmark.hpp"
+#include "Label.hpp"
+
+namespace
+{
+	constexpr size_t NodeCount = 2'000;
+
+	// 種類、名前、文字、色、スタイル、子の数が一致しないWidgetの数を返す
+	size_t CountDifferences(const Widget& a, const Widget& b)
+	{
+		const auto labelA = dynamic_cast<const Label*>(&a);
+		const auto labelB = dynamic_cast<const Label*>(&b);
+
+		size_t differences = 0;
+
+		if ((not labelA != not labelB) ||
+			(labelA && labelA->text() != labelB->text()) ||
+			a.name() != b.name() ||
+			a.borderColor != b.borderColor ||
+			a.style() != b.style())
+		{
+			differences++;
+		}
+
+		if (a.children().size() != b.children().size())
+		{
+			return differences + 1;
+		}
+
+		for (auto itA = a.children().begin(), itB = b.children().begin(); itA != a.children().end(); ++itA, ++itB)
+		{
+			differences += CountDifferences(**itA, **itB);
+		}
+
+		return differences;
+	}
+
+	size_t CountAll(const Widget& widget)
+	{
+		size_t count = 1;
+
+		for (auto& child : widget.children())
+		{
+			count += CountAll(*child);
+		}
+
+		return count;
+	}
+
+	std::shared_ptr<Widget> Load(WidgetTreeLoader& loader, const std::string& json)
+	{
+		std::istringstream stream{ json };
+		return loader.load(stream);
+	}
+
+	// 保存したツリーを読み直すと、同じツリーになる
+	const UnitTest::Registration RoundTripTest{ U"WidgetTreeLoader round trip", [](Array<String>& failures)
+		{
+			const FilePath path = FileSystem::PathAppend(FileSystem::TemporaryDirectoryPath(), U"widget_tree_loader_test.json");
+
+			const auto root = LayoutBenchmark::CreateTree(LayoutBenchmark::Shape::TextGrid, NodeCount);
+			root->setName(U"root");
+			root->children().front()->setName(U"first row");
+
+			if (not WidgetTreeLoader::Save(path, *root))
+			{
+				failures << U"failed to write {}"_fmt(path);
+				return;
+			}
+
+			const size_t nodeCount = CountAll(*root);
+			WidgetTreeLoader loader;
+
+			if (not loader.parse(path) || loader.stats().nodeCount != nodeCount)
+			{
+				failures << U"parse read {} of {} nodes: {}"_fmt(loader.stats().nodeCount, nodeCount, loader.error());
+			}
+
+			const auto loaded = loader.load(path);
+			FileSystem::Remove(path);
+
+			if (not loaded || loader.stats().nodeCount != nodeCount)
+			{
+				failures << U"load read {} of {} nodes: {}"_fmt(loader.stats().nodeCount, nodeCount, loader.error());
+				return;
+			}
+
+			if (const size_t differences = CountDifferences(*root, *loaded))
+			{
+				failures << U"{} loaded widgets differ from the saved tree"_fmt(differences);
+			}
+		} };
+
+	// 文書の外側のオブジェクトや、知らないキーの扱い
+	const UnitTest::Registration DocumentTest{ U"WidgetTreeLoader document", [](Array<String>& failures)
+		{
+			WidgetTreeLoader loader;
+
+			// 知らないキーは中身ごと読み飛ばし、nodeCountは目安としてだけ使う
+			const auto root = Load(loader,
+				R"({ "version": 2, "extra": { "root": { "type": "Label" }, "list": [1, { "a": [] }] },)"
+				R"( "nodeCount": 1e300, "root": { "type": "Widget", "name": "top", "childCount": -5,)"
+				R"( "children": [ { "type": "Label", "text": "Hello" }, { "type": "Widget", "children": [] } ] } })");
+
+			if (not root)
+			{
+				failures << U"a valid document failed to load: {}"_fmt(loader.error());
+			}
+			else if (root->name() != U"top" || root->children().size() != 2 ||
+				not dynamic_cast<const Label*>(root->children().front().get()) || loader.stats().nodeCount != 3)
+			{
+				failures << U"a valid document loaded as a different tree ({} nodes)"_fmt(loader.stats().nodeCount);
+			}
+
+			const std::array<std::string, 5> invalid{
+				R"([ { "root": { "type": "Widget" } } ])",
+				R"("root")",
+				R"({ "nodeCount": 1 })",
+				R"({ "root": { "type": "Button" } })",
+				R"({ "root": { "type": "Widget", "children": [ 1 ] } })",
+			};
+
+			for (const auto& json : invalid)
+			{
+				if (Load(loader, json) || loader.error().isEmpty())
+				{
+					failures << U"an invalid document was accepted: {}"_fmt(Unicode::FromUTF8(json));
+				}
+			}
+		} };
+}
+
+#endif